@@ -10,6 +10,25 @@ Abstract:
 
     Default allocators, INcomaptible with std::allocators
 
+    Protocol: is_empty, is_raw, value_type, size_type, difference_type,
+    allocate(n) and deallocate(ptr, n). Optional extensions, reached
+    through allocator::traits (which falls back when they are absent):
+
+        allocate_at_least(n)              -> { ptr, count }, count >= n is
+                                             the real capacity of the block
+        try_expand_in_place(ptr, n, new_n) -> true if the block at ptr
+                                             already holds new_n elements
+        reallocate(ptr, n, new_n)         -> { ptr, count }, the block resized,
+                                             maybe moved with its bytes (as by
+                                             memcpy); only called for trivially
+                                             relocatable elements
+        alignment                         -> blocks are aligned to it,
+                                             alignof(T) if absent
+
+    Default takes everything from malloc, Aligned from aligned_alloc
+    (AVX loads, a cache line per thread), Pool takes blocks of up to
+    SlotElements elements from a slab pool shared by its instantiation.
+
 Author / Creation date:
 
     JulesIMF / 04.04.22
@@ -25,6 +44,17 @@ Revision History:
 
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 
 //
 // Defines
@@ -32,6 +62,23 @@ Revision History:
 
 namespace jules::allocator
 {
+    template<typename T>
+    struct allocation_result
+    {
+        T* ptr;
+        std::size_t count;
+    };
+
+    // bytes malloc really gave ptr, at least the requested ones
+    [[nodiscard]] inline std::size_t usable_size(void* ptr, [[maybe_unused]] std::size_t requested) noexcept
+    {
+#ifdef __GLIBC__
+        return ptr ? malloc_usable_size(ptr) : 0;
+#else
+        return requested;
+#endif
+    }
+
 
     template<typename T, bool raw_memory = false>
     struct Empty
@@ -47,6 +94,9 @@ namespace jules::allocator
         // void deallocate(value_type* ptr, size_type n);
     };
 
+    // raw memory comes from malloc, so the slack malloc rounds up to is
+    // reported by allocate_at_least, and blocks are resized by realloc,
+    // which grows them in place when the chunk after them is free
     template<typename T, bool raw_memory = false>
     class Default
     {
@@ -63,20 +113,508 @@ namespace jules::allocator
         
         [[nodiscard]] inline value_type* allocate(size_type n)
         {
-            if (raw_memory)
-                return reinterpret_cast<value_type*>(new raw_type[n * sizeof(T)]);
+            return allocate_at_least(n).ptr;
+        }
+
+        [[nodiscard]] inline allocation_result<value_type> allocate_at_least(size_type n)
+        {
+            if constexpr (!raw_memory)
+                return { new T[n], n };
 
             else
-                return new T[n];
+            {
+                if (n == 0)
+                    return { nullptr, 0 };
+
+                void* ptr = std::malloc(n * sizeof(T));
+                if (ptr == nullptr)
+                    throw std::bad_alloc();
+
+                return { static_cast<value_type*>(ptr), usable_size(ptr, n * sizeof(T)) / sizeof(T) };
+            }
+        }
+
+        template<bool raw = raw_memory, typename = std::enable_if_t<raw>>
+        [[nodiscard]] inline allocation_result<value_type> reallocate(value_type* ptr, size_type /* n */, size_type new_n)
+        {
+            void* new_ptr = std::realloc(static_cast<void*>(ptr), new_n * sizeof(T));
+            if (new_ptr == nullptr)
+                throw std::bad_alloc();
+
+            return { static_cast<value_type*>(new_ptr), usable_size(new_ptr, new_n * sizeof(T)) / sizeof(T) };
         }
 
-        inline void deallocate(value_type* ptr, size_type n)
+        inline void deallocate(value_type* ptr, size_type /* n */)
         {
-            if (raw_memory)
-                delete[] reinterpret_cast<raw_type*>(ptr);
+            if constexpr (raw_memory)
+                std::free(ptr);
 
             else
                 delete[] ptr;
         }
     };
+
+    // blocks aligned to Alignment and a multiple of it long, so a vector
+    // of floats starts on a cache line and its tail never shares one
+    template<typename T, bool raw_memory = true, std::size_t Alignment = 64>
+    class Aligned
+    {
+        static_assert(raw_memory, "Aligned: only raw memory!");
+        static_assert((Alignment & (Alignment - 1)) == 0, "Aligned: Alignment must be a power of two!");
+        static_assert(Alignment >= alignof(T), "Aligned: Alignment is below alignof(T)!");
+
+    public:
+        static bool const is_empty = false;
+        static bool const is_raw   = raw_memory;
+        static std::size_t const alignment
+                                   = Alignment;
+        using value_type           = T;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+
+        template<typename U>
+        using rebind               = Aligned<U, raw_memory, (Alignment > alignof(U) ? Alignment : alignof(U))>;
+
+        [[nodiscard]] inline value_type* allocate(size_type n)
+        {
+            return allocate_at_least(n).ptr;
+        }
+
+        [[nodiscard]] inline allocation_result<value_type> allocate_at_least(size_type n)
+        {
+            if (n == 0)
+                return { nullptr, 0 };
+
+            auto bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+            void* ptr = std::aligned_alloc(Alignment, bytes);
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+
+            return { static_cast<value_type*>(ptr), usable_size(ptr, bytes) / sizeof(T) };
+        }
+
+        inline void deallocate(value_type* ptr, size_type /* n */) noexcept
+        {
+            std::free(ptr);
+        }
+    };
+
+    //
+    // Slab pool of equal slots. Slabs are slab_bytes() long and aligned to
+    // it, so a slot finds its slab by masking its address. Every slab keeps
+    // an intrusive free list threaded through its free slots and a bump
+    // pointer to slots never handed out, so fresh slabs are not touched
+    // until used. A slot returns to its own slab; a slab that empties is
+    // kept as a spare if there is none, freed otherwise.
+    //
+    // Not thread safe: one pool per thread, or a lock around it.
+    //
+    class pool
+    {
+    protected:
+        struct slot_
+        {
+            slot_* next;
+        };
+
+        struct slab_
+        {
+            slab_* previous;
+            slab_* next;
+            slot_* free;                        // returned slots
+            uint8_t* fresh;                     // slots from here on were never used
+            std::size_t used;
+        };
+
+        struct list_
+        {
+            slab_* head = nullptr;
+
+            inline void push(slab_* slab) noexcept
+            {
+                slab->previous = nullptr;
+                slab->next = head;
+                if (head != nullptr)
+                    head->previous = slab;
+                head = slab;
+            }
+
+            inline void remove(slab_* slab) noexcept
+            {
+                if (slab->previous != nullptr)
+                    slab->previous->next = slab->next;
+                else
+                    head = slab->next;
+
+                if (slab->next != nullptr)
+                    slab->next->previous = slab->previous;
+            }
+        };
+
+        std::size_t slot_size_;
+        std::size_t slab_bytes_;
+        std::size_t first_slot_;                // offset of slot 0 in a slab
+        std::size_t slots_per_slab_;
+
+        list_ partial_;                         // slabs with free slots
+        list_ full_;
+        slab_* spare_ = nullptr;                // an empty slab kept for reuse
+        std::size_t slabs_ = 0;
+        std::size_t used_ = 0;
+
+        [[nodiscard]] static inline std::size_t round_up_(std::size_t n, std::size_t to) noexcept
+        {
+            return (n + to - 1) / to * to;
+        }
+
+        [[nodiscard]] inline slab_* slab_of_(void* ptr) const noexcept
+        {
+            return reinterpret_cast<slab_*>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t(slab_bytes_) - 1));
+        }
+
+        inline void start_slab_(slab_* slab) noexcept
+        {
+            slab->free = nullptr;
+            slab->fresh = reinterpret_cast<uint8_t*>(slab) + first_slot_;
+            slab->used = 0;
+            partial_.push(slab);
+        }
+
+        inline void add_slab_()
+        {
+            if (spare_ != nullptr)
+            {
+                start_slab_(spare_);
+                spare_ = nullptr;
+                return;
+            }
+
+            auto slab = static_cast<slab_*>(std::aligned_alloc(slab_bytes_, slab_bytes_));
+            if (slab == nullptr)
+                throw std::bad_alloc();
+
+            slabs_++;
+            start_slab_(slab);
+        }
+
+        static inline void free_list_(list_& list) noexcept
+        {
+            for (auto slab = list.head; slab != nullptr;)
+            {
+                auto next = slab->next;
+                std::free(slab);
+                slab = next;
+            }
+
+            list.head = nullptr;
+        }
+
+    public:
+        struct stats
+        {
+            std::size_t slot_size;
+            std::size_t slots_per_slab;
+            std::size_t slabs;                  // spare included
+            std::size_t used;                   // slots
+            std::size_t capacity;               // slots
+
+            [[nodiscard]] inline double occupancy() const noexcept
+            {
+                return capacity != 0 ? static_cast<double>(used) / capacity : 0.0;
+            }
+        };
+
+        // alignment is a power of two; slabs hold at least 8 slots
+        explicit pool(std::size_t slot_size, std::size_t alignment = alignof(std::max_align_t),
+                      std::size_t slab_bytes = std::size_t(64) << 10)
+        {
+            if (alignment < alignof(slot_))
+                alignment = alignof(slot_);
+
+            slot_size_ = round_up_(slot_size < sizeof(slot_) ? sizeof(slot_) : slot_size, alignment);
+            first_slot_ = round_up_(sizeof(slab_), alignment);
+
+            slab_bytes_ = 4096;
+            while (slab_bytes_ < slab_bytes || slab_bytes_ < first_slot_ + 8 * slot_size_)
+                slab_bytes_ *= 2;
+
+            slots_per_slab_ = (slab_bytes_ - first_slot_) / slot_size_;
+        }
+
+        pool(pool const&) = delete;
+        pool& operator=(pool const&) = delete;
+
+        ~pool()
+        {
+            free_list_(partial_);
+            free_list_(full_);
+            std::free(spare_);
+        }
+
+        [[nodiscard]] inline void* allocate()
+        {
+            if (partial_.head == nullptr)
+                add_slab_();
+
+            auto slab = partial_.head;
+            void* ptr;
+            if (slab->free != nullptr)
+            {
+                ptr = slab->free;
+                slab->free = slab->free->next;
+            }
+
+            else
+            {
+                ptr = slab->fresh;
+                slab->fresh += slot_size_;
+            }
+
+            used_++;
+            if (++slab->used == slots_per_slab_)
+            {
+                partial_.remove(slab);
+                full_.push(slab);
+            }
+
+            return ptr;
+        }
+
+        inline void deallocate(void* ptr) noexcept
+        {
+            auto slab = slab_of_(ptr);
+            auto slot = static_cast<slot_*>(ptr);
+            slot->next = slab->free;
+            slab->free = slot;
+            used_--;
+
+            if (slab->used-- == slots_per_slab_)
+            {
+                full_.remove(slab);
+                partial_.push(slab);
+            }
+
+            if (slab->used != 0)
+                return;
+
+            partial_.remove(slab);
+            if (spare_ == nullptr)
+                spare_ = slab;
+
+            else
+            {
+                std::free(slab);
+                slabs_--;
+            }
+        }
+
+        [[nodiscard]] inline std::size_t slot_size() const noexcept
+        {
+            return slot_size_;
+        }
+
+        [[nodiscard]] inline std::size_t slab_bytes() const noexcept
+        {
+            return slab_bytes_;
+        }
+
+        [[nodiscard]] inline stats occupancy() const noexcept
+        {
+            return { slot_size_, slots_per_slab_, slabs_, used_, slabs_ * slots_per_slab_ };
+        }
+    };
+
+    // blocks of up to SlotElements elements come from a pool shared by
+    // every Pool<T, raw_memory, SlotElements>, bigger ones from malloc.
+    // Thread safe: the shared pool is taken under a mutex, like the central
+    // pools of thread_cache.hpp; ThreadCache is the one for hot threads
+    template<typename T, bool raw_memory = true, std::size_t SlotElements = 1>
+    class Pool
+    {
+        static_assert(raw_memory, "Pool: only raw memory!");
+        static_assert(SlotElements != 0, "Pool: SlotElements must be positive!");
+
+    protected:
+        struct shared_
+        {
+            std::mutex lock;
+            pool slabs;
+
+            shared_() :
+                slabs(SlotElements * sizeof(T), alignof(T))
+            {
+            }
+        };
+
+        [[nodiscard]] static inline shared_& shared_pool_() noexcept
+        {
+            static shared_ instance;
+            return instance;
+        }
+
+    public:
+        static bool const is_empty = false;
+        static bool const is_raw   = raw_memory;
+        using value_type           = T;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+
+        template<typename U>
+        using rebind               = Pool<U, raw_memory, SlotElements>;
+
+        [[nodiscard]] static inline pool::stats occupancy()
+        {
+            auto& shared = shared_pool_();
+            std::lock_guard<std::mutex> guard(shared.lock);
+            return shared.slabs.occupancy();
+        }
+
+        [[nodiscard]] inline value_type* allocate(size_type n)
+        {
+            return allocate_at_least(n).ptr;
+        }
+
+        // a slot always holds SlotElements
+        [[nodiscard]] inline allocation_result<value_type> allocate_at_least(size_type n)
+        {
+            if (n == 0)
+                return { nullptr, 0 };
+
+            if (n <= SlotElements)
+            {
+                auto& shared = shared_pool_();
+                std::lock_guard<std::mutex> guard(shared.lock);
+                return { static_cast<value_type*>(shared.slabs.allocate()), SlotElements };
+            }
+
+            void* ptr = std::malloc(n * sizeof(T));
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+
+            return { static_cast<value_type*>(ptr), n };
+        }
+
+        inline void deallocate(value_type* ptr, size_type n) noexcept
+        {
+            if (ptr == nullptr)
+                return;
+
+            if (n <= SlotElements)
+            {
+                auto& shared = shared_pool_();
+                std::lock_guard<std::mutex> guard(shared.lock);
+                shared.slabs.deallocate(ptr);
+            }
+
+            else
+                std::free(ptr);
+        }
+    };
+
+    //
+    // Same allocator for another type, for containers that store something
+    // else than they hold (vector<bool> keeps words). Allocators shaped as
+    // A<T, raw_memory> are rebound as is, others need a rebind<U> member.
+    //
+    template<class Allocator, typename U>
+    struct rebind
+    {
+        using type                 = typename Allocator::template rebind<U>;
+    };
+
+    template<template<typename, bool> class A, typename T, bool raw_memory, typename U>
+    struct rebind<A<T, raw_memory>, U>
+    {
+        using type                 = A<U, raw_memory>;
+    };
+
+    template<class Allocator, typename U>
+    using rebind_t                 = typename rebind<Allocator, U>::type;
+
+    //
+    // Uniform access to the optional parts of the protocol
+    //
+    template<class Allocator>
+    struct traits
+    {
+        using value_type           = typename Allocator::value_type;
+        using size_type            = typename Allocator::size_type;
+
+    protected:
+        template<class A, typename = void>
+        struct alignment_ : std::integral_constant<std::size_t, alignof(value_type)>
+        {
+        };
+
+        template<class A>
+        struct alignment_<A, std::void_t<decltype(A::alignment)>> :
+            std::integral_constant<std::size_t, A::alignment>
+        {
+        };
+
+        template<class A, typename = void>
+        struct has_allocate_at_least_ : std::false_type
+        {
+        };
+
+        template<class A>
+        struct has_allocate_at_least_<A, std::void_t<decltype(std::declval<A&>().allocate_at_least(size_type()))>> :
+            std::true_type
+        {
+        };
+
+        template<class A, typename = void>
+        struct has_try_expand_in_place_ : std::false_type
+        {
+        };
+
+        template<class A>
+        struct has_try_expand_in_place_<A, std::void_t<decltype(std::declval<A&>().try_expand_in_place(
+                                                  std::declval<value_type*>(), size_type(), size_type()))>> :
+            std::true_type
+        {
+        };
+
+        template<class A, typename = void>
+        struct has_reallocate_ : std::false_type
+        {
+        };
+
+        template<class A>
+        struct has_reallocate_<A, std::void_t<decltype(std::declval<A&>().reallocate(
+                                      std::declval<value_type*>(), size_type(), size_type()))>> :
+            std::true_type
+        {
+        };
+
+    public:
+        static std::size_t const alignment
+                                   = alignment_<Allocator>::value;
+        static bool const can_reallocate
+                                   = has_reallocate_<Allocator>::value;
+
+        static allocation_result<value_type> allocate_at_least(Allocator& allocator, size_type n)
+        {
+            if constexpr (has_allocate_at_least_<Allocator>::value)
+                return allocator.allocate_at_least(n);
+
+            else
+                return { allocator.allocate(n), n };
+        }
+
+        static bool try_expand_in_place(Allocator& allocator, value_type* ptr, size_type n, size_type new_n) noexcept
+        {
+            if constexpr (has_try_expand_in_place_<Allocator>::value)
+                return allocator.try_expand_in_place(ptr, n, new_n);
+
+            else
+                return false;
+        }
+
+        // only if can_reallocate
+        static allocation_result<value_type> reallocate(Allocator& allocator, value_type* ptr, size_type n, size_type new_n)
+        {
+            return allocator.reallocate(ptr, n, new_n);
+        }
+    };
 }
\ No newline at end of file
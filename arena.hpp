@@ -0,0 +1,285 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    arena.hpp
+
+Abstract:
+
+    Monotonic arena and the Arena allocator on top of it, for containers
+    that die together (temporaries of one request and so on).
+
+        jules::allocator::arena arena;
+        {
+            jules::allocator::arena::scope use(arena);
+            jules::vector<int, jules::allocator::Arena<int, true>> v;  // takes arena
+            ...
+        }
+        arena.reset();      // every block at once
+
+    Storages default-construct their allocators, so an Arena picks the
+    arena of the innermost scope of its thread when it is created (or is
+    given one explicitly) and keeps it. allocate bumps a pointer inside
+    the current chunk, a full chunk is followed by one twice as big.
+    deallocate does nothing, the newest block grows in place through
+    try_expand_in_place, so a vector being filled does not leave a trail
+    of copies behind.
+
+    reset() frees all chunks but the last one and reuses it, release()
+    frees everything. Containers using the arena must be dead or empty
+    by then.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+
+#include "allocators.hpp"
+
+//
+// Defines
+//
+
+namespace jules::allocator
+{
+    class arena
+    {
+    protected:
+        struct chunk_header_
+        {
+            chunk_header_* previous;
+            std::size_t size;                   // with the header
+        };
+
+        static std::size_t const max_chunk_
+                                   = std::size_t(64) << 20;
+
+        chunk_header_* chunks_ = nullptr;       // newest first
+        uint8_t* cursor_ = nullptr;
+        uint8_t* end_ = nullptr;
+        uint8_t* last_ = nullptr;               // newest block, may grow in place
+        std::size_t next_chunk_;
+        std::size_t used_ = 0;
+        std::size_t reserved_ = 0;
+
+        [[nodiscard]] static inline uint8_t* align_up_(uint8_t* ptr, std::size_t alignment) noexcept
+        {
+            auto address = reinterpret_cast<uintptr_t>(ptr);
+            return reinterpret_cast<uint8_t*>((address + alignment - 1) & ~(uintptr_t(alignment) - 1));
+        }
+
+        [[nodiscard]] static inline arena*& current_() noexcept
+        {
+            static thread_local arena* current = nullptr;
+            return current;
+        }
+
+        inline void add_chunk_(std::size_t bytes, std::size_t alignment)
+        {
+            auto size = sizeof(chunk_header_) + bytes + alignment;
+            if (size < next_chunk_)
+                size = next_chunk_;
+
+            auto header = static_cast<chunk_header_*>(std::malloc(size));
+            if (header == nullptr)
+                throw std::bad_alloc();
+
+            header->previous = chunks_;
+            header->size = size;
+            chunks_ = header;
+            reserved_ += size;
+
+            cursor_ = reinterpret_cast<uint8_t*>(header + 1);
+            end_ = reinterpret_cast<uint8_t*>(header) + size;
+            last_ = nullptr;
+
+            if (next_chunk_ < max_chunk_)
+                next_chunk_ *= 2;
+        }
+
+    public:
+        // RAII: Arena allocators created on this thread while it lives take a
+        class scope
+        {
+            arena* previous_;
+
+        public:
+            explicit scope(arena& a) noexcept :
+                previous_(current_())
+            {
+                current_() = &a;
+            }
+
+            scope(scope const&) = delete;
+            scope& operator=(scope const&) = delete;
+
+            ~scope()
+            {
+                current_() = previous_;
+            }
+        };
+
+        explicit arena(std::size_t first_chunk = std::size_t(64) << 10) noexcept :
+            next_chunk_(first_chunk < 2 * sizeof(chunk_header_) ? 2 * sizeof(chunk_header_) : first_chunk)
+        {
+        }
+
+        arena(arena const&) = delete;
+        arena& operator=(arena const&) = delete;
+
+        ~arena()
+        {
+            release();
+        }
+
+        // innermost scope`s arena on this thread, nullptr if none
+        [[nodiscard]] static inline arena* current() noexcept
+        {
+            return current_();
+        }
+
+        // alignment is a power of two
+        [[nodiscard]] inline void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+        {
+            // aligning may step past end_ when alignment is above malloc`s
+            auto ptr = align_up_(cursor_, alignment);
+            if (cursor_ == nullptr || ptr > end_ || bytes > static_cast<std::size_t>(end_ - ptr))
+            {
+                add_chunk_(bytes, alignment);
+                ptr = align_up_(cursor_, alignment);
+            }
+
+            cursor_ = ptr + bytes;
+            last_ = ptr;
+            used_ += bytes;
+            return ptr;
+        }
+
+        // only the newest block grows, and only inside its chunk
+        inline bool try_expand(void* ptr, std::size_t bytes, std::size_t new_bytes) noexcept
+        {
+            if (ptr == nullptr || ptr != last_ || new_bytes < bytes ||
+                new_bytes > static_cast<std::size_t>(end_ - last_))
+                return false;
+
+            cursor_ = last_ + new_bytes;
+            used_ += new_bytes - bytes;
+            return true;
+        }
+
+        // frees every chunk but the newest (the biggest) and starts over in it
+        inline void reset() noexcept
+        {
+            if (chunks_ == nullptr)
+                return;
+
+            for (auto chunk = chunks_->previous; chunk != nullptr;)
+            {
+                auto previous = chunk->previous;
+                reserved_ -= chunk->size;
+                std::free(chunk);
+                chunk = previous;
+            }
+
+            chunks_->previous = nullptr;
+            cursor_ = reinterpret_cast<uint8_t*>(chunks_ + 1);
+            last_ = nullptr;
+            used_ = 0;
+        }
+
+        inline void release() noexcept
+        {
+            reset();
+            std::free(chunks_);
+            chunks_ = nullptr;
+            cursor_ = end_ = last_ = nullptr;
+            reserved_ = 0;
+        }
+
+        // bytes handed out since the last reset
+        [[nodiscard]] inline std::size_t used() const noexcept
+        {
+            return used_;
+        }
+
+        // bytes taken from malloc
+        [[nodiscard]] inline std::size_t reserved() const noexcept
+        {
+            return reserved_;
+        }
+    };
+
+    // raw memory from an arena, deallocate is a no-op
+    template<typename T, bool raw_memory = true>
+    class Arena
+    {
+        static_assert(raw_memory, "Arena: only raw memory, arenas never run destructors!");
+
+    protected:
+        arena* arena_;
+
+        inline arena& arena_or_throw_() const
+        {
+            if (arena_ == nullptr)
+                std::__throw_logic_error("Arena: created outside of any arena::scope");
+
+            return *arena_;
+        }
+
+    public:
+        static bool const is_empty = false;
+        static bool const is_raw   = raw_memory;
+        using value_type           = T;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+
+        Arena() noexcept :
+            arena_(arena::current())
+        {
+        }
+
+        explicit Arena(arena& a) noexcept :
+            arena_(&a)
+        {
+        }
+
+        [[nodiscard]] inline arena* get_arena() const noexcept
+        {
+            return arena_;
+        }
+
+        [[nodiscard]] inline value_type* allocate(size_type n)
+        {
+            if (n == 0)
+                return nullptr;
+
+            return static_cast<value_type*>(arena_or_throw_().allocate(n * sizeof(T), alignof(T)));
+        }
+
+        inline bool try_expand_in_place(value_type* ptr, size_type n, size_type new_n) noexcept
+        {
+            return arena_ != nullptr && arena_->try_expand(ptr, n * sizeof(T), new_n * sizeof(T));
+        }
+
+        inline void deallocate(value_type* /* ptr */, size_type /* n */) noexcept
+        {
+        }
+    };
+}
@@ -23,9 +23,13 @@ Revision History:
 // Includes / usings
 //
 
+#pragma once
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include "on_stack.hpp"
 #include "on_heap.hpp"
+#include "bits.hpp"
 
 //
 // Defines
@@ -36,12 +40,13 @@ namespace jules
 {
     // example: array<int, 5, storage::on_stack>
     // template<typename T, size_t MaxSize/*, template<typename, size_t> class Storage*/>
-    template<typename T, size_t MaxSize, template<typename, size_t, class> class Storage>
+    template<typename T, size_t MaxSize, template<typename, size_t, class> class Storage,
+                                         class Allocator = jules::allocator::Default<T, true>>
     class array
     {
     protected:
         // #define Storage  storage::on_stack
-        Storage<T, MaxSize, jules::allocator::Default<T, true>> storage_;
+        Storage<T, MaxSize, Allocator> storage_;
         size_t size_ = 0;
 
         inline void check_size_(size_t size, char const* fnc) const
@@ -365,19 +370,19 @@ namespace jules
         }
     };
 
-    template<size_t MaxSize, template<typename, size_t, class> class Storage>
-    class array<bool, MaxSize, Storage>
+    template<size_t MaxSize, template<typename, size_t, class> class Storage, class Allocator>
+    class array<bool, MaxSize, Storage, Allocator>
     {
     protected:
         struct __bool_ref
         {
-        friend class array<bool, MaxSize, Storage>;
+        friend class array<bool, MaxSize, Storage, Allocator>;
         __bool_ref(__bool_ref const&) = default; // not explicit
 
         __bool_ref& operator=(bool value) noexcept
         {
-            octet_ &= ~(1 << bit_);
-            octet_ |= (1 << bit_) * value;
+            auto mask = uint64_t(1) << bit_;
+            word_ = (word_ & ~mask) | (mask * value);
             return *this;
         }
 
@@ -389,57 +394,75 @@ namespace jules
 
         operator bool() const noexcept
         {
-            return (octet_ >> bit_) & 0x1;
+            return (word_ >> bit_) & 0x1;
         }
 
         
         private:
-        __bool_ref(uint8_t& octet, size_t bit) noexcept :
-            octet_(octet), bit_(bit)
+        __bool_ref(uint64_t& word, size_t bit) noexcept :
+            word_(word), bit_(bit)
         {
         }
 
-        static __bool_ref create_(uint8_t* data, size_t index)
+        static __bool_ref create_(uint64_t* data, size_t index)
         {
-            return __bool_ref(data[index >> 3], index & 7ull);
+            return __bool_ref(data[index >> 6], index & 63ull);
         }
 
         private:
-            uint8_t& octet_;
+            uint64_t& word_;
             size_t const bit_;
         };
 
         struct __bool_const_ref
         {
-        friend class array<bool, MaxSize, Storage>;
+        friend class array<bool, MaxSize, Storage, Allocator>;
         __bool_const_ref(__bool_const_ref const&) = default; // not explicit
 
         operator bool() const noexcept
         {
-            return (octet_ >> bit_) & 0x1;
+            return (word_ >> bit_) & 0x1;
         }
 
         
         private:
-        __bool_const_ref(uint8_t const& octet, size_t bit) noexcept :
-            octet_(octet), bit_(bit)
+        __bool_const_ref(uint64_t const& word, size_t bit) noexcept :
+            word_(word), bit_(bit)
         {
         }
 
-        static __bool_const_ref create_(uint8_t const* data, size_t index)
+        static __bool_const_ref create_(uint64_t const* data, size_t index)
         {
-            return __bool_const_ref(data[index >> 3], index & 7ull);
+            return __bool_const_ref(data[index >> 6], index & 63ull);
         }
 
         private:
-            uint8_t const& octet_;
+            uint64_t const& word_;
             size_t const bit_;
         };
     
+        static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, 
+            "array<bool>: data() octet view relies on little endian words!");
+
     protected:
-        static size_t constexpr Capacity = (MaxSize + 7) / 8;
-        Storage<uint8_t, Capacity, jules::allocator::Default<uint8_t, true>> storage_;
+        using word_type = jules::bits::word_type;
+
+        // bits past size_ in the last word are always zero
+        static size_t constexpr Capacity = (MaxSize + 63) / 64;
+        Storage<word_type, Capacity, jules::allocator::rebind_t<Allocator, word_type>> storage_;
         size_t size_ = 0;
+        mutable std::shared_ptr<jules::bits::watch> watch_;     // null until watch() is asked for
+
+        // call after any change to size_ and before handing out mutable words
+        inline void touched_() noexcept
+        {
+            if (watch_)
+            {
+                watch_->words = storage_.data();
+                watch_->size = size_;
+                watch_->generation++;
+            }
+        }
 
         inline void check_size_(size_t size, char const* fnc) const
         {
@@ -457,81 +480,100 @@ namespace jules
                     fnc, index, size_);
         }
 
+        // sets [size_, new_size) to value
+        inline void grow_filled_(size_t new_size, bool value) noexcept
+        {
+            auto words = word_data();
+            auto used = jules::bits::words_number(size_);
+            if (value && size_ % 64 != 0)
+                words[used - 1] |= jules::bits::all_ones << (size_ % 64);
+
+            for (auto i = used; i != jules::bits::words_number(new_size); i++)
+                words[i] = value ? jules::bits::all_ones : 0;
+
+            size_ = new_size;
+            touched_();
+            clear_tail_();
+        }
+
+        inline void clear_tail_() noexcept
+        {
+            if (size_ % 64 != 0)
+                word_data()[size_ / 64] &= jules::bits::tail_mask(size_);
+        }
+
+        template<class Op>
+        inline array& combine_(array const& other)
+        {
+            if (other.size_ > size_)
+                resize(other.size_);
+
+            jules::bits::combine<Op>(word_data(), other.word_data(), other.word_count(), word_count());
+            return *this;
+        }
+
+        inline void copy_words_(array const& origin) noexcept
+        {
+            size_ = origin.size_;
+            touched_();
+            for (size_t i = 0; i != jules::bits::words_number(size_); i++)
+                word_data()[i] = origin.word_data()[i];
+        }
+
     public:
-        explicit array(size_t size = 0) noexcept :
-            size_(size)
+        explicit array(size_t size = 0)
         {
-            check_size_(size_, "array::array(size_t)");
-            for (size_t i = 0; i < size_; i++)
-                storage_.create(i / 8, 0);
+            check_size_(size, "array::array(size_t)");
+            grow_filled_(size, false);
         }
 
         template<typename U>
-        explicit array(size_t size, U&& value) :
-            size_(size)
+        explicit array(size_t size, U&& value)
         {
-            check_size_(size_, "array::array(size_t, U)");
-            bool fill = !!(value);
-            for (size_t i = 0; i != size_; i++)
-                at_unchecked(i) = fill;
+            check_size_(size, "array::array(size_t, U)");
+            grow_filled_(size, !!(value));
         }
 
         // not explicit!
-        array(std::initializer_list<bool> list) :
-            size_(list.size())
+        array(std::initializer_list<bool> list)
         {
-            check_size_(size_, "array::array(std::initializer_list<T>)");
-
-            size_t i = 0;
-            for (auto it = list.begin(); it != list.end(); ++it, i++)
-                at_unchecked(i) = !!(*it);
+            *this = list;
         }
 
-        array(array const& origin) noexcept :
-            size_(origin.size_)
+        array(array const& origin) noexcept
         {
-            size_t i = 0;
-            for (; i != (size_ + 7) / 8; i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));
+            copy_words_(origin);
         }
 
-        array(array&& origin) noexcept :
-            size_(origin.size_)
+        array(array&& origin) noexcept
         {
-            size_t i = 0;
-            for (; i != (size_ + 7) / 8; i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));
+            copy_words_(origin);
         }
 
         // void clear() noexcept;
 
         ~array() noexcept
         {
-            
+            clear();
         }
 
-        array& operator=(array const& origin)
+        array& operator=(array const& origin) noexcept
         {
-            size_t i = 0;
-            for (; i != (size_ + 7) / 8; i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));
-
+            copy_words_(origin);
             return *this;
         }
 
-        array& operator=(array&& origin)
+        array& operator=(array&& origin) noexcept
         {
-            size_t i = 0;
-            for (; i != (size_ + 7) / 8; i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));
-
+            copy_words_(origin);
             return *this;
         }
 
         array& operator=(std::initializer_list<bool> const& list)
         {
-            size_ = list.size();
-            check_size_(size_, "array::operator=(std::initializer_list<T>)");
+            check_size_(list.size(), "array::operator=(std::initializer_list<T>)");
+            size_ = 0;
+            grow_filled_(list.size(), false);
 
             size_t i = 0;
             for (auto it = list.begin(); it != list.end(); it++, i++)
@@ -586,14 +628,45 @@ namespace jules
             return operator[](size_ - 1);
         }
 
-        [[nodiscard]] inline uint8_t const* data(size_t index) const noexcept
+        // bit i is bit i % 8 of octet i / 8
+        [[nodiscard]] inline uint8_t const* data() const noexcept
+        {
+            return reinterpret_cast<uint8_t const*>(storage_.data());
+        }
+
+        [[nodiscard]] inline uint8_t* data() noexcept
+        {
+            touched_();
+            return const_cast<uint8_t*>(static_cast<array const*>(this)->data());
+        }
+
+        // bit i is bit i % 64 of word i / 64
+        [[nodiscard]] inline word_type const* word_data() const noexcept
         {
             return storage_.data();
         }
 
-        [[nodiscard]] inline uint8_t* data(size_t index) noexcept
+        // counts as a write, the words may change through it
+        [[nodiscard]] inline word_type* word_data() noexcept
+        {
+            touched_();
+            return const_cast<word_type*>(static_cast<array const*>(this)->word_data());
+        }
+
+        // for indexes over the words (rank_select), see bits::watch;
+        // single bit writes through __bool_ref are not counted
+        [[nodiscard]] inline std::shared_ptr<jules::bits::watch const> watch() const
+        {
+            if (!watch_)
+                watch_ = std::make_shared<jules::bits::watch>(
+                    jules::bits::watch{ storage_.data(), size_, 0 });
+
+            return watch_;
+        }
+
+        [[nodiscard]] inline size_t word_count() const noexcept
         {
-            return const_cast<array*>(static_cast<array const*>(this)->data());
+            return jules::bits::words_number(size_);
         }
 
         //
@@ -623,7 +696,7 @@ namespace jules
         //
         // Modifiers
         //
-        void resize(size_t new_size) noexcept
+        void resize(size_t new_size)
         {
             if (new_size == size_)
                 return;
@@ -631,20 +704,189 @@ namespace jules
             check_size_(new_size, "array::resize()");
 
             if (new_size > size_)
-            {
-                for (size_t i = size_; i != new_size; i++)
-                    at_unchecked(i) = false;
-
-                size_ = new_size;
-            }
+                grow_filled_(new_size, false);
 
             else
+            {
                 size_ = new_size;
+                touched_();
+                clear_tail_();
+            }
         }
 
         void clear() noexcept
         {
             size_ = 0;
+            touched_();
+        }
+
+        // sets every bit to value
+        inline void fill(bool value) noexcept
+        {
+            for (size_t i = 0; i != word_count(); i++)
+                word_data()[i] = value ? jules::bits::all_ones : 0;
+
+            clear_tail_();
+        }
+
+        inline void flip() noexcept
+        {
+            jules::bits::invert(word_data(), word_count());
+            clear_tail_();
+        }
+
+        //
+        // Bitwise, the shorter operand is zero-extended and the result
+        // has the longer size; shifts keep the size
+        //
+
+        inline array& operator&=(array const& other)
+        {
+            return combine_<jules::bits::op_and>(other);
+        }
+
+        inline array& operator|=(array const& other)
+        {
+            return combine_<jules::bits::op_or>(other);
+        }
+
+        inline array& operator^=(array const& other)
+        {
+            return combine_<jules::bits::op_xor>(other);
+        }
+
+        // this &= ~other
+        inline array& andnot(array const& other)
+        {
+            return combine_<jules::bits::op_andnot>(other);
+        }
+
+        // bit i goes to i + shift, bits pushed past size() are lost
+        inline array& operator<<=(size_t shift) noexcept
+        {
+            jules::bits::shift_up(word_data(), word_count(), shift);
+            clear_tail_();
+            return *this;
+        }
+
+        // bit i goes to i - shift, top bits become zero
+        inline array& operator>>=(size_t shift) noexcept
+        {
+            jules::bits::shift_down(word_data(), word_count(), shift);
+            return *this;
+        }
+
+        [[nodiscard]] inline array operator~() const
+        {
+            auto result = *this;
+            result.flip();
+            return result;
+        }
+
+        [[nodiscard]] friend inline array operator&(array lhs, array const& rhs)
+        {
+            lhs &= rhs;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline array operator|(array lhs, array const& rhs)
+        {
+            lhs |= rhs;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline array operator^(array lhs, array const& rhs)
+        {
+            lhs ^= rhs;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline array andnot(array lhs, array const& rhs)
+        {
+            lhs.andnot(rhs);
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline array operator<<(array lhs, size_t shift) noexcept
+        {
+            lhs <<= shift;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline array operator>>(array lhs, size_t shift) noexcept
+        {
+            lhs >>= shift;
+            return lhs;
+        }
+
+        //
+        // Set bit iteration, cost follows count() rather than size()
+        //
+
+        template<typename Fn>
+        inline void for_each_set_bit(Fn&& fn) const
+        {
+            jules::bits::for_each_set(word_data(), size_, std::forward<Fn>(fn));
+        }
+
+        // skips empty 256 bit blocks, for very sparse bits
+        template<typename Fn>
+        inline void for_each_set_bit_sparse(Fn&& fn) const
+        {
+            jules::bits::for_each_set_sparse(word_data(), size_, std::forward<Fn>(fn));
+        }
+
+        // four positions per step, for dense bits
+        template<typename Fn>
+        inline void for_each_set_bit_dense(Fn&& fn) const
+        {
+            jules::bits::for_each_set_dense(word_data(), size_, std::forward<Fn>(fn));
+        }
+
+        // for (auto i : v.set_bits()), valid while this is alive and unchanged
+        [[nodiscard]] inline jules::bits::set_bit_range set_bits() const noexcept
+        {
+            return jules::bits::set_bit_range(word_data(), size_);
+        }
+
+        //
+        // Bit queries, searches return size() when nothing is found
+        //
+
+        [[nodiscard]] inline size_t count() const noexcept
+        {
+            return jules::bits::count(word_data(), size_);
+        }
+
+        [[nodiscard]] inline bool any() const noexcept
+        {
+            return jules::bits::any(word_data(), size_);
+        }
+
+        [[nodiscard]] inline bool none() const noexcept
+        {
+            return jules::bits::none(word_data(), size_);
+        }
+
+        [[nodiscard]] inline size_t find_first() const noexcept
+        {
+            return jules::bits::find_first(word_data(), size_);
+        }
+
+        // first set bit at pos or after it
+        [[nodiscard]] inline size_t find_next(size_t pos) const noexcept
+        {
+            return jules::bits::find_next(word_data(), size_, pos);
+        }
+
+        [[nodiscard]] inline size_t find_first_clear() const noexcept
+        {
+            return jules::bits::find_first_clear(word_data(), size_);
+        }
+
+        [[nodiscard]] inline size_t find_next_clear(size_t pos) const noexcept
+        {
+            return jules::bits::find_next_clear(word_data(), size_, pos);
         }
     };
 }
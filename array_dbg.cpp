@@ -24,8 +24,11 @@ Revision History:
 //
 
 #include "array.hpp"
+#include "atomic_bitset.hpp"
 #include <dbg.hpp>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 //
 // Defines
@@ -288,6 +291,178 @@ void bool_specialization()
     jules::tests::complete();
 }
 
+void bool_bit_queries()
+{
+    jules::tests::start("bool_bit_queries");
+    jules::array<bool, 1000, jules::storage::on_stack> arr(1000);
+
+    jules::tests::test("empty array",
+        [&]
+        {
+            std::cout << arr.count() << " " << arr.any() << arr.none() << " "
+                      << arr.find_first() << " " << arr.find_first_clear();
+        },
+            "0 01 1000 0");
+
+    jules::tests::test("count and find",
+        [&]
+        {
+            arr[3] = arr[64] = arr[700] = arr[999] = true;
+            std::cout << arr.count() << " " << arr.find_first() << " " << arr.find_next(4) << " "
+                      << arr.find_next(65) << " " << arr.find_next(701) << " " << arr.find_next(1000);
+        },
+            "4 3 64 700 999 1000");
+
+    jules::tests::test("clear bits",
+        [&]
+        {
+            arr = jules::array<bool, 1000, jules::storage::on_stack>(1000, true);
+            arr[777] = false;
+            std::cout << arr.find_first_clear() << " " << arr.find_next_clear(778) << " " << arr.count();
+            arr.resize(500);
+            std::cout << " " << arr.find_first_clear() << " " << arr.count();
+        },
+            "777 1000 999 500 500");
+
+    jules::tests::complete();
+}
+
+void bool_bitwise()
+{
+    jules::tests::start("bool_bitwise");
+    using bits = jules::array<bool, 300, jules::storage::on_stack>;
+
+    bits a = { 1, 1, 0, 0, 1 };
+    bits b = { 1, 0, 1 };
+
+    auto print = [](bits const& x)
+    {
+        for (size_t i = 0; i != x.size(); i++)
+            std::cout << x[i];
+    };
+
+    jules::tests::test("shorter operand is zero-extended",
+        [&]
+        {
+            print(a & b);
+            std::cout << " ";
+            print(b | a);
+            std::cout << " ";
+            print(andnot(a, b));
+            std::cout << " ";
+            print(~(a ^ b));
+        },
+            "10000 11101 01001 10010");
+
+    jules::tests::test("shifts",
+        [&]
+        {
+            bits x(300);
+            x[0] = x[150] = x[299] = true;
+            auto up = x << 150;
+            auto down = x >> 150;
+            std::cout << up.count() << up.find_first() << up.find_next(151) << " " 
+                      << down.count() << down.find_first() << down.find_next(1);
+        },
+            "1150300 20149");
+
+    jules::tests::complete();
+}
+
+void bool_set_bits()
+{
+    jules::tests::start("bool_set_bits");
+    jules::array<bool, 200, jules::storage::on_stack> arr(200);
+    arr[5] = arr[64] = arr[199] = true;
+
+    jules::tests::test("for_each_set_bit and set_bits",
+        [&]
+        {
+            arr.for_each_set_bit_sparse([](size_t i) { std::cout << i << " "; });
+            for (auto i : arr.set_bits())
+                std::cout << i << " ";
+        },
+            "5 64 199 5 64 199 ");
+
+    jules::tests::complete();
+}
+
+void atomic_bitset()
+{
+    jules::tests::start("atomic_bitset");
+    jules::atomic_bitset<100000, jules::storage::on_heap> visited(99999);
+
+    jules::tests::test_exception("bounds checked",
+        [&]
+        {
+            visited.set(99999);
+        });
+
+    jules::tests::test("single thread updates",
+        [&]
+        {
+            std::cout << visited.test_and_set(5) << visited.test_and_set(5) << visited[5] << " "
+                      << visited.test_and_reset(5) << visited.test_and_reset(5) << " ";
+
+            visited.set_range(60, 130);
+            std::cout << visited.count() << visited.find_first() << " "
+                      << visited.fetch_or_word(1562, jules::bits::all_ones) << " "
+                      << visited.count() << " " << visited.find_next(130) << " ";
+
+            visited.clear();
+            std::cout << visited.none();
+        },
+            "011 10 7060 0 101 99968 1");
+
+    jules::tests::test("concurrent writers lose nothing",
+        [&]
+        {
+            // neighbouring bits of the same words, every bit claimed exactly once
+            size_t const threads = 8;
+            std::vector<size_t> claimed(threads);
+            std::vector<std::thread> workers;
+            for (size_t t = 0; t != threads; t++)
+                workers.emplace_back([&, t]
+                {
+                    for (size_t i = 0; i != visited.size(); i++)
+                    {
+                        auto bit = (i * threads + t) % visited.size();
+                        claimed[t] += !visited.test_and_set(bit);
+                    }
+                });
+
+            for (auto& worker : workers)
+                worker.join();
+
+            size_t total = 0;
+            for (auto c : claimed)
+                total += c;
+
+            std::cout << total << " " << visited.count();
+        },
+            "99999 99999");
+
+    jules::tests::test("merge and snapshot",
+        [&]
+        {
+            visited.clear();
+            jules::array<bool, 100000, jules::storage::on_heap> local(1000);
+            local[3] = local[999] = true;
+            visited.set(3);
+
+            std::cout << visited.merge(local) << visited.merge(local) << " ";
+
+            auto copy = visited.snapshot();
+            std::cout << copy.size() << " " << copy.count() << copy[999];
+
+            jules::atomic_bitset<1000> from(local);
+            std::cout << " " << from.size() << from.count();
+        },
+            "10 99999 21 10002");
+
+    jules::tests::complete();
+}
+
 void strange_tests()
 {
     jules::tests::start("strange_tests");
@@ -306,5 +481,9 @@ int main()
     on_stack();
     on_heap();
     bool_specialization();
+    bool_bit_queries();
+    bool_bitwise();
+    bool_set_bits();
+    atomic_bitset();
     strange_tests();
 }
\ No newline at end of file
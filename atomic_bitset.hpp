@@ -0,0 +1,332 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    atomic_bitset.hpp
+
+Abstract:
+
+    Fixed size bitset shared between threads. Same layout as array<bool>
+    (bit i is bit i % 64 of word i / 64, bits past size() are zero), but
+    the words are std::atomic<uint64_t> and every write is one atomic
+    read-modify-write on its word, so concurrent writers never lose
+    each other`s bits:
+
+        test_and_set / test_and_reset  - fetch_or / fetch_and, return the old bit
+        set / reset                    - the same without the result
+        fetch_or_word / fetch_and_word - batch updates of up to 64 bits
+        merge(bits)                    - fetch_or of every non-zero word of
+                                         a vector<bool> / array<bool>
+
+    Reads default to memory_order_relaxed, which is a plain load on
+    x86 and ARM. A snapshot taken while others write sees every word
+    at some point of its own history, not the whole set at one instant.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include "array.hpp"
+#include "bits.hpp"
+
+//
+// Defines
+//
+
+namespace jules
+{
+    template<size_t MaxSize, template<typename, size_t, class> class Storage = jules::storage::on_stack>
+    class atomic_bitset
+    {
+    public:
+        using word_type            = jules::bits::word_type;
+        using atomic_word          = std::atomic<word_type>;
+        using snapshot_type        = jules::array<bool, MaxSize, Storage>;
+
+        static_assert(atomic_word::is_always_lock_free,
+            "atomic_bitset: 64-bit atomics must be lock free!");
+
+    protected:
+        static size_t constexpr Capacity = (MaxSize + 63) / 64;
+        Storage<atomic_word, Capacity, jules::allocator::Default<atomic_word, true>> storage_;
+        size_t size_ = 0;
+
+        inline void check_size_(size_t size, char const* fnc) const
+        {
+            if (size > MaxSize)
+                std::__throw_out_of_range_fmt("%s: "
+                    "size_t == %zu exceeds max_size == %zu",
+                    fnc, size, MaxSize);
+        }
+
+        inline void check_index_(size_t index, char const* fnc) const
+        {
+            if (index >= size_)
+                std::__throw_out_of_range_fmt("%s: "
+                    "index == %zu out of range within size == %zu",
+                    fnc, index, size_);
+        }
+
+        [[nodiscard]] inline atomic_word& word_of_(size_t index) noexcept
+        {
+            return storage_.at_unchecked(index / 64);
+        }
+
+        [[nodiscard]] static inline word_type mask_of_(size_t index) noexcept
+        {
+            return word_type(1) << (index % 64);
+        }
+
+    public:
+        //
+        // Constructors / destructors
+        //
+
+        // all bits clear
+        explicit atomic_bitset(size_t size = MaxSize)
+        {
+            check_size_(size, "atomic_bitset::atomic_bitset(size_t)");
+            size_ = size;
+            for (size_t i = 0; i != word_count(); i++)
+                storage_.create(i, word_type(0));
+        }
+
+        // copies bits, no other thread may see this yet
+        template<class Bits, typename = decltype(std::declval<Bits const&>().word_data())>
+        explicit atomic_bitset(Bits const& bits)
+        {
+            check_size_(bits.size(), "atomic_bitset::atomic_bitset(Bits const&)");
+            size_ = bits.size();
+            for (size_t i = 0; i != word_count(); i++)
+                storage_.create(i, bits.word_data()[i]);
+        }
+
+        // shared between threads by reference only
+        atomic_bitset(atomic_bitset const&) = delete;
+        atomic_bitset& operator=(atomic_bitset const&) = delete;
+
+        ~atomic_bitset()
+        {
+            for (size_t i = 0; i != word_count(); i++)
+                storage_.destroy(i);
+        }
+
+        //
+        // Capacity
+        //
+
+        [[nodiscard]] inline size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] static constexpr size_t max_size() noexcept
+        {
+            return MaxSize;
+        }
+
+        [[nodiscard]] inline size_t word_count() const noexcept
+        {
+            return jules::bits::words_number(size_);
+        }
+
+        //
+        // Reads
+        //
+
+        [[nodiscard]] inline bool test(size_t index, std::memory_order order = std::memory_order_relaxed) const
+        {
+            check_index_(index, "atomic_bitset::test(size_t)");
+            return (load_word(index / 64, order) >> (index % 64)) & 1;
+        }
+
+        [[nodiscard]] inline bool operator[](size_t index) const
+        {
+            return test(index);
+        }
+
+        [[nodiscard]] inline word_type load_word(size_t word, std::memory_order order = std::memory_order_relaxed) const noexcept
+        {
+            return storage_.at_unchecked(word).load(order);
+        }
+
+        // words loaded one by one into an array<bool>
+        [[nodiscard]] inline snapshot_type snapshot(std::memory_order order = std::memory_order_relaxed) const
+        {
+            snapshot_type result(size_);
+            for (size_t i = 0; i != word_count(); i++)
+                result.word_data()[i] = load_word(i, order);
+
+            return result;
+        }
+
+        [[nodiscard]] inline size_t count(std::memory_order order = std::memory_order_relaxed) const noexcept
+        {
+            size_t result = 0;
+            for (size_t i = 0; i != word_count(); i++)
+                result += jules::bits::popcount(load_word(i, order));
+
+            return result;
+        }
+
+        [[nodiscard]] inline bool any(std::memory_order order = std::memory_order_relaxed) const noexcept
+        {
+            for (size_t i = 0; i != word_count(); i++)
+                if (load_word(i, order) != 0)
+                    return true;
+
+            return false;
+        }
+
+        [[nodiscard]] inline bool none(std::memory_order order = std::memory_order_relaxed) const noexcept
+        {
+            return !any(order);
+        }
+
+        // first set bit at pos or after it, size() if none
+        [[nodiscard]] inline size_t find_next(size_t pos, std::memory_order order = std::memory_order_relaxed) const noexcept
+        {
+            if (pos >= size_)
+                return size_;
+
+            auto word = load_word(pos / 64, order) & (jules::bits::all_ones << (pos % 64));
+            for (size_t i = pos / 64;;)
+            {
+                if (word != 0)
+                    return i * 64 + jules::bits::lowest(word);
+
+                if (++i == word_count())
+                    return size_;
+
+                word = load_word(i, order);
+            }
+        }
+
+        [[nodiscard]] inline size_t find_first(std::memory_order order = std::memory_order_relaxed) const noexcept
+        {
+            return find_next(0, order);
+        }
+
+        //
+        // Writes, one atomic read-modify-write per touched word
+        //
+
+        // true if the bit was already set
+        inline bool test_and_set(size_t index, std::memory_order order = std::memory_order_acq_rel)
+        {
+            check_index_(index, "atomic_bitset::test_and_set(size_t)");
+            return word_of_(index).fetch_or(mask_of_(index), order) & mask_of_(index);
+        }
+
+        // true if the bit was set
+        inline bool test_and_reset(size_t index, std::memory_order order = std::memory_order_acq_rel)
+        {
+            check_index_(index, "atomic_bitset::test_and_reset(size_t)");
+            return word_of_(index).fetch_and(~mask_of_(index), order) & mask_of_(index);
+        }
+
+        inline void set(size_t index, bool value = true, std::memory_order order = std::memory_order_release)
+        {
+            check_index_(index, "atomic_bitset::set(size_t, bool)");
+            if (value)
+                word_of_(index).fetch_or(mask_of_(index), order);
+            else
+                word_of_(index).fetch_and(~mask_of_(index), order);
+        }
+
+        inline void reset(size_t index, std::memory_order order = std::memory_order_release)
+        {
+            set(index, false, order);
+        }
+
+        // returns the old word, mask bits past size() are ignored
+        inline word_type fetch_or_word(size_t word, word_type mask, std::memory_order order = std::memory_order_acq_rel)
+        {
+            if (word >= word_count())
+                std::__throw_out_of_range_fmt("atomic_bitset::fetch_or_word(size_t, word_type): "
+                    "word == %zu out of range within word_count == %zu",
+                    word, word_count());
+
+            if (word == size_ / 64)
+                mask &= jules::bits::tail_mask(size_);
+
+            return storage_.at_unchecked(word).fetch_or(mask, order);
+        }
+
+        // returns the old word
+        inline word_type fetch_and_word(size_t word, word_type mask, std::memory_order order = std::memory_order_acq_rel)
+        {
+            if (word >= word_count())
+                std::__throw_out_of_range_fmt("atomic_bitset::fetch_and_word(size_t, word_type): "
+                    "word == %zu out of range within word_count == %zu",
+                    word, word_count());
+
+            return storage_.at_unchecked(word).fetch_and(mask, order);
+        }
+
+        // sets [from, to)
+        inline void set_range(size_t from, size_t to, std::memory_order order = std::memory_order_release)
+        {
+            if (from > to || to > size_)
+                std::__throw_out_of_range_fmt("atomic_bitset::set_range(size_t, size_t): "
+                    "[%zu, %zu) out of range within size == %zu",
+                    from, to, size_);
+
+            for (auto i = from / 64; i < jules::bits::words_number(to); i++)
+            {
+                auto mask = jules::bits::all_ones;
+                if (i == from / 64)
+                    mask &= jules::bits::all_ones << (from % 64);
+                if (i == to / 64)
+                    mask &= jules::bits::tail_mask(to);
+
+                storage_.at_unchecked(i).fetch_or(mask, order);
+            }
+        }
+
+        // ors in a vector<bool> / array<bool> no longer than this, zero words
+        // are skipped so their cache lines stay shared; returns new ones
+        template<class Bits>
+        inline size_t merge(Bits const& bits, std::memory_order order = std::memory_order_acq_rel)
+        {
+            if (bits.size() > size_)
+                std::__throw_out_of_range_fmt("atomic_bitset::merge(Bits const&): "
+                    "size == %zu exceeds size == %zu",
+                    bits.size(), size_);
+
+            size_t added = 0;
+            for (size_t i = 0; i != bits.word_count(); i++)
+            {
+                auto word = bits.word_data()[i];
+                if (word != 0)
+                    added += jules::bits::popcount(word & ~storage_.at_unchecked(i).fetch_or(word, order));
+            }
+
+            return added;
+        }
+
+        // not atomic as a whole, each word is
+        inline void clear(std::memory_order order = std::memory_order_release) noexcept
+        {
+            for (size_t i = 0; i != word_count(); i++)
+                storage_.at_unchecked(i).store(0, order);
+        }
+    };
+}
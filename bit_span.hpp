@@ -0,0 +1,495 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    bit_span.hpp
+
+Abstract:
+
+    Non-owning view of size bits starting at any bit of a byte buffer,
+    in the octet layout of vector<bool>::data(): bit i is bit i % 8 of
+    byte i / 8. Parts of vector<bool> / array<bool>, bitmaps received in
+    network buffers or mmap`ed files are used in place:
+
+        jules::bit_span       - reads and writes
+        jules::const_bit_span - reads only, bit_span converts to it
+
+    The span touches only the bytes holding its bits, so buffers need not
+    be padded or aligned. Its first and last bytes may be shared with
+    bits next to it: writes read and rewrite them whole, keeping those
+    bits but racing with whoever writes them meanwhile. Kernels work a
+    word of the span at a time through memcpy loads; spans of
+    vector<bool> / array<bool> starting at a word go through the bits.hpp
+    kernels (AVX2 included) for their whole words, raw buffers never do,
+    their bytes are not word_type objects.
+
+    The buffer must outlive the span, a vector<bool> must not be resized.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "bits.hpp"
+
+//
+// Defines
+//
+
+namespace jules
+{
+    // Byte is uint8_t or uint8_t const
+    template<typename Byte>
+    class basic_bit_span
+    {
+        static_assert(std::is_same<std::remove_const_t<Byte>, uint8_t>::value,
+            "basic_bit_span: Byte must be uint8_t or uint8_t const!");
+        static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+            "basic_bit_span: word loads rely on little endian bytes!");
+
+        template<typename>
+        friend class basic_bit_span;
+
+    public:
+        using size_type            = std::size_t;
+        using word_type            = jules::bits::word_type;
+        using byte_type            = Byte;
+
+        static bool const is_const = std::is_const<Byte>::value;
+
+    protected:
+        static size_type const word_bits_
+                                   = jules::bits::word_bits;
+
+        Byte* bytes_ = nullptr;                 // byte holding the first bit
+        size_type offset_ = 0;                  // of the first bit in it, < 8
+        size_type size_ = 0;
+        word_type const* words_ = nullptr;      // word at bytes_ of the container, if any
+
+        [[nodiscard]] inline size_type bytes_number_() const noexcept
+        {
+            return (offset_ + size_ + 7) / 8;
+        }
+
+        // starts a word of a real word array, so whole words may go to bits.hpp
+        [[nodiscard]] inline bool aligned_() const noexcept
+        {
+            return words_ != nullptr;
+        }
+
+        [[nodiscard]] inline size_type full_words_() const noexcept
+        {
+            return size_ / word_bits_;
+        }
+
+        // bits of the span`s word that belong to the span
+        [[nodiscard]] inline word_type word_mask_(size_type i) const noexcept
+        {
+            return (i == full_words_()) ? jules::bits::tail_mask(size_) : jules::bits::all_ones;
+        }
+
+        inline void check_index_(size_type index, char const* fnc) const
+        {
+            if (index >= size_)
+                std::__throw_out_of_range_fmt("%s: "
+                    "index == %zu out of range within size == %zu",
+                    fnc, index, size_);
+        }
+
+        template<bool Invert>
+        [[nodiscard]] inline size_type find_next_(size_type pos) const noexcept
+        {
+            if (pos >= size_)
+                return size_;
+
+            auto full = full_words_() * word_bits_;
+            if (aligned_() && pos < full)
+            {
+                auto found = Invert ? jules::bits::find_next_clear(words_, full, pos) :
+                                      jules::bits::find_next(words_, full, pos);
+                if (found != full)
+                    return found;
+
+                pos = full;
+                if (pos == size_)
+                    return size_;
+            }
+
+            auto const flip = Invert ? jules::bits::all_ones : word_type(0);
+            for (auto i = pos / word_bits_; i != word_count(); i++)
+            {
+                auto word = (load_word(i) ^ flip) & word_mask_(i);
+                if (i == pos / word_bits_)
+                    word &= jules::bits::all_ones << (pos % word_bits_);
+
+                if (word != 0)
+                    return i * word_bits_ + jules::bits::lowest(word);
+            }
+
+            return size_;
+        }
+
+        template<class Op, typename OtherByte>
+        inline basic_bit_span const& combine_(basic_bit_span<OtherByte> const& other) const
+        {
+            static_assert(!is_const, "bit_span: can`t write through const_bit_span!");
+            if (other.size_ > size_)
+                std::__throw_length_error("bit_span: operand is longer than the span");
+
+            size_type i = 0;
+            if (aligned_() && other.aligned_())
+            {
+                // other`s whole words, this is zero-extended past them by combine
+                auto words = std::min(other.full_words_(), full_words_());
+                jules::bits::combine<Op>(const_cast<word_type*>(words_), other.words_, words, words);
+                i = words;
+            }
+
+            for (; i != word_count(); i++)
+                store_word(i, Op::apply(load_word(i), i < other.word_count() ? other.load_word(i) : 0));
+
+            return *this;
+        }
+
+    public:
+        //
+        // Constructors
+        //
+
+        basic_bit_span() = default;
+
+        // size bits from bit offset of data
+        basic_bit_span(Byte* data, size_type size, size_type offset = 0) noexcept :
+            bytes_(data + offset / 8),
+            offset_(offset % 8),
+            size_(size)
+        {
+        }
+
+        // whole vector<bool> / array<bool>
+        template<class Bits, typename = decltype(std::declval<Bits&>().data(), std::declval<Bits&>().word_data())>
+        basic_bit_span(Bits& bits) noexcept : // not explicit
+            basic_bit_span(bits.data(), bits.size())
+        {
+            words_ = bits.word_data();
+        }
+
+        // [first, first + count) of vector<bool> / array<bool>
+        template<class Bits, typename = decltype(std::declval<Bits&>().data(), std::declval<Bits&>().word_data())>
+        basic_bit_span(Bits& bits, size_type first, size_type count) :
+            basic_bit_span(bits.data(), count, first)
+        {
+            if (first > bits.size() || count > bits.size() - first)
+                std::__throw_out_of_range_fmt("bit_span::bit_span(Bits&, size_t, size_t): "
+                    "[%zu, %zu + %zu) out of range within size == %zu",
+                    first, first, count, bits.size());
+
+            if (first % word_bits_ == 0)
+                words_ = bits.word_data() + first / word_bits_;
+        }
+
+        // bit_span -> const_bit_span
+        template<typename OtherByte, typename = std::enable_if_t<std::is_const<Byte>::value &&
+                                                                 !std::is_const<OtherByte>::value>>
+        basic_bit_span(basic_bit_span<OtherByte> const& other) noexcept : // not explicit
+            bytes_(other.bytes_),
+            offset_(other.offset_),
+            size_(other.size_),
+            words_(other.words_)
+        {
+        }
+
+        [[nodiscard]] inline basic_bit_span subspan(size_type first, size_type count) const
+        {
+            if (first > size_ || count > size_ - first)
+                std::__throw_out_of_range_fmt("bit_span::subspan(size_t, size_t): "
+                    "[%zu, %zu + %zu) out of range within size == %zu",
+                    first, first, count, size_);
+
+            basic_bit_span result(bytes_, count, offset_ + first);
+            if (aligned_() && first % word_bits_ == 0)
+                result.words_ = words_ + first / word_bits_;
+
+            return result;
+        }
+
+        //
+        // Capacity
+        //
+
+        [[nodiscard]] inline bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        [[nodiscard]] inline size_type size() const noexcept
+        {
+            return size_;
+        }
+
+        // byte holding bit 0, and the bit in it
+        [[nodiscard]] inline Byte* data() const noexcept
+        {
+            return bytes_;
+        }
+
+        [[nodiscard]] inline size_type offset() const noexcept
+        {
+            return offset_;
+        }
+
+        //
+        // Element access
+        //
+
+        [[nodiscard]] inline bool test(size_type index) const
+        {
+            check_index_(index, "bit_span::test(size_t)");
+            auto bit = offset_ + index;
+            return (bytes_[bit / 8] >> (bit % 8)) & 1;
+        }
+
+        [[nodiscard]] inline bool operator[](size_type index) const
+        {
+            return test(index);
+        }
+
+        inline void set(size_type index, bool value = true) const
+        {
+            static_assert(!is_const, "bit_span: can`t write through const_bit_span!");
+            check_index_(index, "bit_span::set(size_t, bool)");
+            auto bit = offset_ + index;
+            auto mask = static_cast<uint8_t>(1u << (bit % 8));
+            bytes_[bit / 8] = static_cast<uint8_t>((bytes_[bit / 8] & ~mask) | (value ? mask : 0));
+        }
+
+        inline void reset(size_type index) const
+        {
+            set(index, false);
+        }
+
+        //
+        // Words: bit i of the span is bit i % 64 of word i / 64,
+        // bits past size() read as zero and are never written
+        //
+
+        [[nodiscard]] inline size_type word_count() const noexcept
+        {
+            return jules::bits::words_number(size_);
+        }
+
+        [[nodiscard]] inline word_type load_word(size_type i) const noexcept
+        {
+            auto first = i * sizeof(word_type);
+            auto available = bytes_number_() - first;
+
+            // fixed size copies are single loads, only the last word is short
+            word_type low = 0;
+            if (available >= sizeof(word_type))
+                std::memcpy(&low, bytes_ + first, sizeof(word_type));
+            else
+                std::memcpy(&low, bytes_ + first, available);
+
+            auto word = low >> offset_;
+            if (offset_ != 0 && available > sizeof(word_type))
+                word |= word_type(bytes_[first + sizeof(word_type)]) << (word_bits_ - offset_);
+
+            return word & word_mask_(i);
+        }
+
+        inline void store_word(size_type i, word_type word) const noexcept
+        {
+            static_assert(!is_const, "bit_span: can`t write through const_bit_span!");
+            auto mask = word_mask_(i);
+            word &= mask;
+
+            auto first = i * sizeof(word_type);
+            auto available = bytes_number_() - first;
+            auto n = std::min(available, sizeof(word_type));
+
+            word_type low = 0;
+            if (n == sizeof(word_type))
+            {
+                std::memcpy(&low, bytes_ + first, sizeof(word_type));
+                low = (low & ~(mask << offset_)) | (word << offset_);
+                std::memcpy(bytes_ + first, &low, sizeof(word_type));
+            }
+
+            else
+            {
+                std::memcpy(&low, bytes_ + first, n);
+                low = (low & ~(mask << offset_)) | (word << offset_);
+                std::memcpy(bytes_ + first, &low, n);
+            }
+
+            if (offset_ != 0 && available > sizeof(word_type))
+            {
+                auto spill = word_bits_ - offset_;
+                auto high_mask = static_cast<uint8_t>(mask >> spill);
+                auto& byte = bytes_[first + sizeof(word_type)];
+                byte = static_cast<uint8_t>((byte & ~high_mask) | ((word >> spill) & high_mask));
+            }
+        }
+
+        //
+        // Bit queries, searches return size() when nothing is found
+        //
+
+        [[nodiscard]] inline size_type count() const noexcept
+        {
+            size_type result = 0, i = 0;
+            if (aligned_())
+            {
+                result = jules::bits::count(words_, full_words_() * word_bits_);
+                i = full_words_();
+            }
+
+            for (; i != word_count(); i++)
+                result += jules::bits::popcount(load_word(i));
+
+            return result;
+        }
+
+        [[nodiscard]] inline size_type find_first() const noexcept
+        {
+            return find_next_<false>(0);
+        }
+
+        [[nodiscard]] inline size_type find_next(size_type pos) const noexcept
+        {
+            return find_next_<false>(pos);
+        }
+
+        [[nodiscard]] inline size_type find_first_clear() const noexcept
+        {
+            return find_next_<true>(0);
+        }
+
+        [[nodiscard]] inline size_type find_next_clear(size_type pos) const noexcept
+        {
+            return find_next_<true>(pos);
+        }
+
+        [[nodiscard]] inline bool any() const noexcept
+        {
+            return find_first() != size_;
+        }
+
+        [[nodiscard]] inline bool none() const noexcept
+        {
+            return !any();
+        }
+
+        [[nodiscard]] inline bool all() const noexcept
+        {
+            return find_first_clear() == size_;
+        }
+
+        template<typename Fn>
+        inline void for_each_set_bit(Fn&& fn) const
+        {
+            for (size_type i = 0; i != word_count(); i++)
+                for (auto word = load_word(i); word != 0; word &= word - 1)
+                    fn(i * word_bits_ + jules::bits::lowest(word));
+        }
+
+        //
+        // Writes, the span is a view: they change the viewed bits
+        //
+
+        inline void fill(bool value) const noexcept
+        {
+            for (size_type i = 0; i != word_count(); i++)
+                store_word(i, value ? jules::bits::all_ones : 0);
+        }
+
+        inline void flip() const noexcept
+        {
+            for (size_type i = 0; i != word_count(); i++)
+                store_word(i, ~load_word(i));
+        }
+
+        // other may be shorter and is zero-extended, as for vector<bool>
+        template<typename OtherByte>
+        inline basic_bit_span const& operator&=(basic_bit_span<OtherByte> const& other) const
+        {
+            return combine_<jules::bits::op_and>(other);
+        }
+
+        template<typename OtherByte>
+        inline basic_bit_span const& operator|=(basic_bit_span<OtherByte> const& other) const
+        {
+            return combine_<jules::bits::op_or>(other);
+        }
+
+        template<typename OtherByte>
+        inline basic_bit_span const& operator^=(basic_bit_span<OtherByte> const& other) const
+        {
+            return combine_<jules::bits::op_xor>(other);
+        }
+
+        // this &= ~other
+        template<typename OtherByte>
+        inline basic_bit_span const& andnot(basic_bit_span<OtherByte> const& other) const
+        {
+            return combine_<jules::bits::op_andnot>(other);
+        }
+
+        // copies other`s bits, sizes must match
+        template<typename OtherByte>
+        inline void assign(basic_bit_span<OtherByte> const& other) const
+        {
+            static_assert(!is_const, "bit_span: can`t write through const_bit_span!");
+            if (other.size_ != size_)
+                std::__throw_length_error("bit_span::assign: sizes differ");
+
+            for (size_type i = 0; i != word_count(); i++)
+                store_word(i, other.load_word(i));
+        }
+
+        //
+        // Comparison
+        //
+
+        // same bits, wherever they lie
+        template<typename OtherByte>
+        [[nodiscard]] inline bool operator==(basic_bit_span<OtherByte> const& other) const noexcept
+        {
+            if (size_ != other.size_)
+                return false;
+
+            for (size_type i = 0; i != word_count(); i++)
+                if (load_word(i) != other.load_word(i))
+                    return false;
+
+            return true;
+        }
+
+        template<typename OtherByte>
+        [[nodiscard]] inline bool operator!=(basic_bit_span<OtherByte> const& other) const noexcept
+        {
+            return !(*this == other);
+        }
+    };
+
+    using bit_span             = basic_bit_span<uint8_t>;
+    using const_bit_span       = basic_bit_span<uint8_t const>;
+}
@@ -0,0 +1,678 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    bits.hpp
+
+Abstract:
+
+    Word-level kernels for bit containers (vector<bool>, array<bool>).
+
+    Bits live in 64-bit words, bit i is bit i % 64 of word i / 64.
+    Every function takes the words and the number of valid bits; bits
+    past it in the last word are ignored, whatever they hold.
+
+    Built with AVX2 (-mavx2 / -march=native) long runs are scanned 256
+    bits per load, otherwise one word at a time. popcount / ctz become
+    popcnt / tzcnt when the target has them, select_in_word uses pdep
+    with BMI2.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+
+#if defined(__AVX2__) || defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+//
+// Defines
+//
+
+namespace jules::bits
+{
+    using word_type            = uint64_t;
+    static std::size_t const word_bits
+                               = 8 * sizeof(word_type);
+    static word_type const all_ones
+                               = ~word_type(0);
+
+    [[nodiscard]] inline std::size_t words_number(std::size_t bits) noexcept
+    {
+        return (bits + word_bits - 1) / word_bits;
+    }
+
+    // words and size of a bit container as of its last change, shared with
+    // the indexes built over it (rank_select) so they may outlive it;
+    // generation goes up on every change to the size, buffer or words
+    // handed out through word_data(), and once more when the container dies
+    struct watch
+    {
+        word_type const* words = nullptr;
+        std::size_t size = 0;
+        std::size_t generation = 0;
+    };
+
+    // ones in [0, bits % word_bits), all ones if bits is a whole number of words
+    [[nodiscard]] inline word_type tail_mask(std::size_t bits) noexcept
+    {
+        return bits % word_bits == 0 ? all_ones : ~(all_ones << (bits % word_bits));
+    }
+
+    [[nodiscard]] inline std::size_t popcount(word_type word) noexcept
+    {
+        return static_cast<std::size_t>(__builtin_popcountll(word));
+    }
+
+    // word must not be 0
+    [[nodiscard]] inline std::size_t lowest(word_type word) noexcept
+    {
+        return static_cast<std::size_t>(__builtin_ctzll(word));
+    }
+
+    // position of the k-th (from 0) set bit of word, k < popcount(word)
+    [[nodiscard]] inline std::size_t select_in_word(word_type word, std::size_t k) noexcept
+    {
+#ifdef __BMI2__
+        return lowest(_pdep_u64(word_type(1) << k, word));
+#else
+        std::size_t base = 0;
+        for (;; base += 8, word >>= 8)
+        {
+            auto ones = popcount(word & 0xFF);
+            if (k < ones)
+                break;
+
+            k -= ones;
+        }
+
+        for (; k != 0; k--)
+            word &= word - 1;
+
+        return base + lowest(word);
+#endif
+    }
+
+#ifdef __AVX2__
+    // popcount of each 64-bit lane, nibble lookup (W. Mula)
+    [[nodiscard]] inline __m256i popcount_lanes_(__m256i v) noexcept
+    {
+        auto const lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                             0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+        auto const low_mask = _mm256_set1_epi8(0x0F);
+
+        auto low  = _mm256_and_si256(v, low_mask);
+        auto high = _mm256_and_si256(_mm256_srli_epi16(v, 4), low_mask);
+        auto bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, low),
+                                     _mm256_shuffle_epi8(lookup, high));
+        return _mm256_sad_epu8(bytes, _mm256_setzero_si256());
+    }
+#endif
+
+    [[nodiscard]] inline std::size_t count(word_type const* words, std::size_t bits) noexcept
+    {
+        if (bits == 0)
+            return 0;
+
+        auto full = bits / word_bits;
+        std::size_t result = 0;
+        std::size_t i = 0;
+
+#ifdef __AVX2__
+        // byte counters of one block can`t overflow, lanes are summed every block
+        auto sum = _mm256_setzero_si256();
+        for (; i + 4 <= full; i += 4)
+        {
+            auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i));
+            sum = _mm256_add_epi64(sum, popcount_lanes_(v));
+        }
+
+        result += static_cast<std::size_t>(_mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) +
+                                           _mm256_extract_epi64(sum, 2) + _mm256_extract_epi64(sum, 3));
+#endif
+
+        for (; i != full; i++)
+            result += popcount(words[i]);
+
+        if (bits % word_bits != 0)
+            result += popcount(words[full] & tail_mask(bits));
+
+        return result;
+    }
+
+    //
+    // Searches return bits (one past the last) when nothing is found.
+    // Invert turns a search for set bits into a search for clear ones.
+    //
+
+    template<bool Invert>
+    [[nodiscard]] inline std::size_t find_next_(word_type const* words, std::size_t bits, std::size_t pos) noexcept
+    {
+        if (pos >= bits)
+            return bits;
+
+        auto const flip = Invert ? all_ones : word_type(0);
+        auto n = words_number(bits);
+        auto i = pos / word_bits;
+
+        auto word = (words[i] ^ flip) & (all_ones << (pos % word_bits));
+        if (word == 0)
+        {
+            i++;
+
+#ifdef __AVX2__
+            // skip 256 bit blocks with nothing to find
+            auto const ones = _mm256_set1_epi64x(-1);
+            for (; i + 4 <= n; i += 4)
+            {
+                auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i));
+                if (Invert ? !_mm256_testc_si256(v, ones) : !_mm256_testz_si256(v, v))
+                    break;
+            }
+#endif
+
+            for (; i < n; i++)
+                if ((word = words[i] ^ flip) != 0)
+                    break;
+
+            if (i >= n)
+                return bits;
+        }
+
+        auto result = i * word_bits + lowest(word);
+        return result < bits ? result : bits;
+    }
+
+    [[nodiscard]] inline std::size_t find_next(word_type const* words, std::size_t bits, std::size_t pos) noexcept
+    {
+        return find_next_<false>(words, bits, pos);
+    }
+
+    [[nodiscard]] inline std::size_t find_first(word_type const* words, std::size_t bits) noexcept
+    {
+        return find_next_<false>(words, bits, 0);
+    }
+
+    [[nodiscard]] inline std::size_t find_next_clear(word_type const* words, std::size_t bits, std::size_t pos) noexcept
+    {
+        return find_next_<true>(words, bits, pos);
+    }
+
+    [[nodiscard]] inline std::size_t find_first_clear(word_type const* words, std::size_t bits) noexcept
+    {
+        return find_next_<true>(words, bits, 0);
+    }
+
+    [[nodiscard]] inline bool any(word_type const* words, std::size_t bits) noexcept
+    {
+        return find_first(words, bits) != bits;
+    }
+
+    [[nodiscard]] inline bool none(word_type const* words, std::size_t bits) noexcept
+    {
+        return !any(words, bits);
+    }
+
+    [[nodiscard]] inline bool all(word_type const* words, std::size_t bits) noexcept
+    {
+        return find_first_clear(words, bits) == bits;
+    }
+
+    //
+    // Bulk operations. Containers keep bits past their size zero, so
+    // results of these keep them zero as well.
+    //
+
+    // dst op= src word by word; absorbs_zero means dst op 0 == 0
+    struct op_and
+    {
+        static bool const absorbs_zero
+                                   = true;
+
+        static word_type apply(word_type dst, word_type src) noexcept
+        {
+            return dst & src;
+        }
+
+#ifdef __AVX2__
+        static __m256i apply(__m256i dst, __m256i src) noexcept
+        {
+            return _mm256_and_si256(dst, src);
+        }
+#endif
+    };
+
+    struct op_or
+    {
+        static bool const absorbs_zero
+                                   = false;
+
+        static word_type apply(word_type dst, word_type src) noexcept
+        {
+            return dst | src;
+        }
+
+#ifdef __AVX2__
+        static __m256i apply(__m256i dst, __m256i src) noexcept
+        {
+            return _mm256_or_si256(dst, src);
+        }
+#endif
+    };
+
+    struct op_xor
+    {
+        static bool const absorbs_zero
+                                   = false;
+
+        static word_type apply(word_type dst, word_type src) noexcept
+        {
+            return dst ^ src;
+        }
+
+#ifdef __AVX2__
+        static __m256i apply(__m256i dst, __m256i src) noexcept
+        {
+            return _mm256_xor_si256(dst, src);
+        }
+#endif
+    };
+
+    // dst & ~src
+    struct op_andnot
+    {
+        static bool const absorbs_zero
+                                   = false;
+
+        static word_type apply(word_type dst, word_type src) noexcept
+        {
+            return dst & ~src;
+        }
+
+#ifdef __AVX2__
+        static __m256i apply(__m256i dst, __m256i src) noexcept
+        {
+            return _mm256_andnot_si256(src, dst);
+        }
+#endif
+    };
+
+    // src is src_words long and zero-extended to dst_words >= src_words
+    template<class Op>
+    inline void combine(word_type* dst, word_type const* src, std::size_t src_words, std::size_t dst_words) noexcept
+    {
+        std::size_t i = 0;
+
+#ifdef __AVX2__
+        for (; i + 4 <= src_words; i += 4)
+        {
+            auto d = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(dst + i));
+            auto s = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), Op::apply(d, s));
+        }
+#endif
+
+        for (; i != src_words; i++)
+            dst[i] = Op::apply(dst[i], src[i]);
+
+        if constexpr (Op::absorbs_zero)
+            for (; i != dst_words; i++)
+                dst[i] = 0;
+    }
+
+    // whole words are inverted, caller clears the tail
+    inline void invert(word_type* words, std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+
+#ifdef __AVX2__
+        auto const ones = _mm256_set1_epi64x(-1);
+        for (; i + 4 <= n; i += 4)
+        {
+            auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), _mm256_xor_si256(v, ones));
+        }
+#endif
+
+        for (; i != n; i++)
+            words[i] = ~words[i];
+    }
+
+    // bit i goes to i + shift, low bits become zero; caller clears the tail
+    inline void shift_up(word_type* words, std::size_t n, std::size_t shift) noexcept
+    {
+        auto q = shift / word_bits;
+        auto r = shift % word_bits;
+        if (q >= n)
+        {
+            for (std::size_t i = 0; i != n; i++)
+                words[i] = 0;
+            return;
+        }
+
+        // from the top, sources are below destinations
+        auto i = n;
+
+#ifdef __AVX2__
+        if (r != 0)
+        {
+            auto const left  = _mm_cvtsi64_si128(static_cast<long long>(r));
+            auto const right = _mm_cvtsi64_si128(static_cast<long long>(word_bits - r));
+            for (; i >= q + 1 + 4; i -= 4)
+            {
+                auto high = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i - 4 - q));
+                auto low  = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i - 4 - q - 1));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i - 4),
+                                    _mm256_or_si256(_mm256_sll_epi64(high, left), _mm256_srl_epi64(low, right)));
+            }
+        }
+#endif
+
+        for (; i != q; i--)
+        {
+            auto j = i - 1 - q;
+            words[i - 1] = (r == 0) ? words[j] :
+                           (words[j] << r) | (j == 0 ? 0 : words[j - 1] >> (word_bits - r));
+        }
+
+        for (std::size_t k = 0; k != q; k++)
+            words[k] = 0;
+    }
+
+    // bit i goes to i - shift, high bits become zero; tail must be clear
+    inline void shift_down(word_type* words, std::size_t n, std::size_t shift) noexcept
+    {
+        auto q = shift / word_bits;
+        auto r = shift % word_bits;
+        if (q >= n)
+        {
+            for (std::size_t i = 0; i != n; i++)
+                words[i] = 0;
+            return;
+        }
+
+        // from the bottom, sources are above destinations
+        std::size_t i = 0;
+
+#ifdef __AVX2__
+        if (r != 0)
+        {
+            auto const right = _mm_cvtsi64_si128(static_cast<long long>(r));
+            auto const left  = _mm_cvtsi64_si128(static_cast<long long>(word_bits - r));
+            for (; i + q + 4 < n; i += 4)
+            {
+                auto low  = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i + q));
+                auto high = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i + q + 1));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i),
+                                    _mm256_or_si256(_mm256_srl_epi64(low, right), _mm256_sll_epi64(high, left)));
+            }
+        }
+#endif
+
+        for (; i + q != n; i++)
+        {
+            auto j = i + q;
+            words[i] = (r == 0) ? words[j] :
+                       (words[j] >> r) | (j + 1 == n ? 0 : words[j + 1] << (word_bits - r));
+        }
+
+        for (; i != n; i++)
+            words[i] = 0;
+    }
+
+    //
+    // Range moves for insert / erase: whole words go through the shift
+    // kernels, only the boundary word is patched bit by bit.
+    //
+
+    // bits [from, to) become value
+    inline void fill_range(word_type* words, std::size_t from, std::size_t to, bool value) noexcept
+    {
+        if (from >= to)
+            return;
+
+        auto first = from / word_bits;
+        auto last = (to - 1) / word_bits;
+        auto head = all_ones << (from % word_bits);
+        auto tail = tail_mask(to);
+        auto fill = value ? all_ones : word_type(0);
+
+        if (first == last)
+        {
+            auto mask = head & tail;
+            words[first] = (words[first] & ~mask) | (fill & mask);
+            return;
+        }
+
+        words[first] = (words[first] & ~head) | (fill & head);
+        for (auto i = first + 1; i != last; i++)
+            words[i] = fill;
+
+        words[last] = (words[last] & ~tail) | (fill & tail);
+    }
+
+    // [from, end) goes to [from + shift, end + shift), bits below from stay
+    // and [from, from + shift) is left unspecified. words must hold
+    // end + shift bits, all of them past end zero
+    inline void move_up(word_type* words, std::size_t from, std::size_t end, std::size_t shift) noexcept
+    {
+        if (shift == 0 || from >= end)
+            return;
+
+        auto first = from / word_bits;
+        auto low = ~(all_ones << (from % word_bits));
+        auto saved = words[first];
+
+        shift_up(words + first, words_number(end + shift) - first, shift);
+        words[first] = (words[first] & ~low) | (saved & low);
+    }
+
+    // [from, end) goes to [from - shift, end - shift), bits below from - shift
+    // stay and everything from end - shift to the end of its word is zero
+    inline void move_down(word_type* words, std::size_t from, std::size_t end, std::size_t shift) noexcept
+    {
+        if (shift == 0)
+            return;
+
+        auto target = from - shift;
+        auto first = target / word_bits;
+        auto low = ~(all_ones << (target % word_bits));
+        auto saved = words[first];
+
+        shift_down(words + first, words_number(end) - first, shift);
+        words[first] = (words[first] & ~low) | (saved & low);
+    }
+
+    //
+    // Set bit iteration: tzcnt finds the lowest set bit, word &= word - 1
+    // (blsr) clears it, so the cost follows popcount, not the length.
+    //
+
+    [[nodiscard]] inline word_type word_at_(word_type const* words, std::size_t bits, std::size_t i) noexcept
+    {
+        return (i + 1 == words_number(bits)) ? words[i] & tail_mask(bits) : words[i];
+    }
+
+    template<typename Fn>
+    inline void for_each_set(word_type const* words, std::size_t bits, Fn&& fn)
+    {
+        auto n = words_number(bits);
+        for (std::size_t i = 0; i != n; i++)
+            for (auto word = word_at_(words, bits, i); word != 0; word &= word - 1)
+                fn(i * word_bits + lowest(word));
+    }
+
+    // for very sparse bits: empty 256 bit blocks are skipped with one test
+    template<typename Fn>
+    inline void for_each_set_sparse(word_type const* words, std::size_t bits, Fn&& fn)
+    {
+        auto n = words_number(bits);
+        std::size_t i = 0;
+        while (i != n)
+        {
+#ifdef __AVX2__
+            if (i + 4 <= n)
+            {
+                auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(words + i));
+                if (_mm256_testz_si256(v, v))
+                {
+                    i += 4;
+                    continue;
+                }
+            }
+#endif
+
+            for (auto end = (i + 4 < n) ? i + 4 : n; i != end; i++)
+                for (auto word = word_at_(words, bits, i); word != 0; word &= word - 1)
+                    fn(i * word_bits + lowest(word));
+        }
+    }
+
+    // for dense bits: positions of a word are produced four at a time,
+    // branching once per four bits instead of once per bit
+    template<typename Fn>
+    inline void for_each_set_dense(word_type const* words, std::size_t bits, Fn&& fn)
+    {
+        auto n = words_number(bits);
+        for (std::size_t i = 0; i != n; i++)
+        {
+            auto word = word_at_(words, bits, i);
+            auto base = i * word_bits;
+            auto ones = popcount(word);
+
+            for (; ones >= 4; ones -= 4)
+            {
+                auto a = lowest(word);
+                word &= word - 1;
+                auto b = lowest(word);
+                word &= word - 1;
+                auto c = lowest(word);
+                word &= word - 1;
+                auto d = lowest(word);
+                word &= word - 1;
+
+                fn(base + a);
+                fn(base + b);
+                fn(base + c);
+                fn(base + d);
+            }
+
+            for (; ones != 0; ones--, word &= word - 1)
+                fn(base + lowest(word));
+        }
+    }
+
+    // forward iterator over positions of set bits
+    class set_bit_iterator
+    {
+    public:
+        using value_type           = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+        using pointer              = std::size_t const*;
+        using reference            = std::size_t;
+        using iterator_category    = std::forward_iterator_tag;
+
+    protected:
+        word_type const* words_;
+        std::size_t bits_;
+        std::size_t index_;         // current word, words_number(bits_) at the end
+        word_type word_;            // its bits not visited yet
+
+        // moves to the first word with something left, starting at index_
+        inline void settle_() noexcept
+        {
+            auto n = words_number(bits_);
+            while (word_ == 0 && ++index_ < n)
+                word_ = word_at_(words_, bits_, index_);
+
+            if (index_ >= n)
+            {
+                index_ = n;
+                word_ = 0;
+            }
+        }
+
+    public:
+        set_bit_iterator(word_type const* words, std::size_t bits, bool end) noexcept :
+            words_(words),
+            bits_(bits),
+            index_(end ? words_number(bits) : 0),
+            word_(0)
+        {
+            if (!end && bits_ != 0)
+            {
+                word_ = word_at_(words_, bits_, 0);
+                settle_();
+            }
+        }
+
+        reference operator*() const noexcept
+        {
+            return index_ * word_bits + lowest(word_);
+        }
+
+        set_bit_iterator& operator++() noexcept
+        {
+            word_ &= word_ - 1;
+            settle_();
+            return *this;
+        }
+
+        set_bit_iterator operator++(int) noexcept
+        {
+            auto prev = *this;
+            ++(*this);
+            return prev;
+        }
+
+        bool operator==(set_bit_iterator const& that) const noexcept
+        {
+            return index_ == that.index_ && word_ == that.word_;
+        }
+
+        bool operator!=(set_bit_iterator const& that) const noexcept
+        {
+            return !(*this == that);
+        }
+    };
+
+    class set_bit_range
+    {
+    protected:
+        word_type const* words_;
+        std::size_t bits_;
+
+    public:
+        set_bit_range(word_type const* words, std::size_t bits) noexcept :
+            words_(words),
+            bits_(bits)
+        {
+        }
+
+        set_bit_iterator begin() const noexcept
+        {
+            return set_bit_iterator(words_, bits_, false);
+        }
+
+        set_bit_iterator end() const noexcept
+        {
+            return set_bit_iterator(words_, bits_, true);
+        }
+    };
+}
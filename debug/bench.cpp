@@ -0,0 +1,76 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    bench.cpp
+
+Abstract:
+
+
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <functional>
+#include <limits>
+
+//
+// Defines
+//
+
+static std::string currentBench = "unnamed";
+
+namespace jules::bench
+{
+    void start(std::string const& suiteName)
+    {
+        currentBench = suiteName;
+        printf("\nRunning benchmark %s...\n", currentBench.c_str());
+        printf("-----------------------------------------------------\n");
+    }
+
+    double measure(std::string const& benchName, std::function<void()> fnc, int repeats)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int i = 0; i != repeats; i++)
+        {
+            auto begin = std::chrono::steady_clock::now();
+            fnc();
+            auto end = std::chrono::steady_clock::now();
+
+            double ms = std::chrono::duration<double, std::milli>(end - begin).count();
+            if (ms < best)
+                best = ms;
+        }
+
+        printf("%-40s %10.3f ms (best of %d)\n", benchName.c_str(), best, repeats);
+        return best;
+    }
+
+    void speedup(double baseline, double optimized)
+    {
+        printf("%-40s %10.2fx\n", "speedup", baseline / optimized);
+    }
+
+    void complete()
+    {
+        printf("-----------------------------------------------------\n");
+        printf("Benchmark %s completed!\n\n", currentBench.c_str());
+        currentBench = "unnamed";
+    }
+}
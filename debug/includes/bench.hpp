@@ -0,0 +1,42 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    bench.hpp
+
+Abstract:
+
+    Tiny timing helpers for *_bench executables.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <functional>
+#include <string>
+
+//
+// Defines
+//
+
+
+namespace jules::bench
+{
+    // returns best time (in ms) of repeats runs
+    double measure(std::string const& benchName, std::function<void()> fnc, int repeats = 5);
+    void speedup(double baseline, double optimized);
+    void start(std::string const& suiteName);
+    void complete();
+}
@@ -0,0 +1,112 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    growth.hpp
+
+Abstract:
+
+    Capacity growth / shrink policies for vector.
+
+    A policy is a type with two static functions, both taking capacities
+    and sizes in elements:
+
+        grow(capacity, required, element_size)  -> new capacity >= required
+        shrink(capacity, size, element_size)    -> new capacity >= size,
+                                                   capacity means "keep"
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <algorithm>
+
+//
+// Defines
+//
+
+namespace jules::growth
+{
+    //
+    // Shrinks only when size drops to a quarter of capacity and then leaves
+    // half of the new block free, so push / pop around any size does not
+    // reallocate every time. Never goes below one cache line of elements.
+    //
+    struct hysteresis_shrink
+    {
+        static std::size_t const cache_line
+                                   = 64;
+
+        static std::size_t min_capacity(std::size_t element_size) noexcept
+        {
+            return std::max(cache_line / element_size, static_cast<std::size_t>(1));
+        }
+
+        static std::size_t shrink(std::size_t capacity, std::size_t size, std::size_t element_size) noexcept
+        {
+            auto min = min_capacity(element_size);
+            if (capacity <= min || size * 4 > capacity)
+                return capacity;
+
+            return std::max(size * 2, min);
+        }
+    };
+
+    // capacity * Numerator / Denominator until required fits
+    template<std::size_t Numerator, std::size_t Denominator>
+    struct geometric : hysteresis_shrink
+    {
+        static_assert(Numerator > Denominator, "growth::geometric: factor must be > 1");
+
+        static std::size_t grow(std::size_t capacity, std::size_t required, std::size_t element_size) noexcept
+        {
+            auto new_capacity = std::max(capacity, min_capacity(element_size));
+            while (new_capacity < required)
+                new_capacity = std::max(new_capacity * Numerator / Denominator, new_capacity + 1);
+
+            return new_capacity;
+        }
+    };
+
+    using doubling     = geometric<2, 1>;
+    using one_and_half = geometric<3, 2>;
+
+    // Base growth, block rounded up to whole pages once it is at least a page
+    template<class Base = doubling, std::size_t PageSize = 4096>
+    struct page_rounded : Base
+    {
+        static std::size_t grow(std::size_t capacity, std::size_t required, std::size_t element_size) noexcept
+        {
+            auto new_capacity = Base::grow(capacity, required, element_size);
+            auto bytes = new_capacity * element_size;
+            if (bytes < PageSize)
+                return new_capacity;
+
+            bytes = (bytes + PageSize - 1) / PageSize * PageSize;
+            return bytes / element_size;
+        }
+    };
+
+    // Base growth, capacity is only ever released by shrink_to_fit
+    template<class Base = doubling>
+    struct never_shrink : Base
+    {
+        static std::size_t shrink(std::size_t capacity, std::size_t, std::size_t) noexcept
+        {
+            return capacity;
+        }
+    };
+}
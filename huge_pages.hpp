@@ -0,0 +1,205 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    huge_pages.hpp
+
+Abstract:
+
+    Allocator for big tables read at random, where every access would
+    otherwise miss the TLB:
+
+        jules::vector<uint64_t, jules::allocator::HugePages<uint64_t, true>> table;
+
+    Blocks of huge_page (2 MB) and more are anonymous mmap regions, 2 MB
+    aligned and a whole number of 2 MB long, advised MADV_HUGEPAGE so the
+    kernel backs them with transparent huge pages (THP must be "always"
+    or "madvise" in /sys/kernel/mm/transparent_hugepage/enabled). With
+    HugeTLB they are tried with MAP_HUGETLB first, which needs pages
+    reserved in vm.nr_hugepages, and fall back to THP when it fails.
+    Growth tries mremap in place before storage::on_heap copies anything.
+
+    Smaller blocks come from malloc, as Default does. Linux only.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+
+#include "allocators.hpp"
+
+//
+// Defines
+//
+
+namespace jules::allocator
+{
+    class huge_pages
+    {
+    public:
+        static std::size_t constexpr huge_page
+                                   = std::size_t(2) << 20;
+
+        [[nodiscard]] static constexpr std::size_t round_up(std::size_t bytes) noexcept
+        {
+            return (bytes + huge_page - 1) / huge_page * huge_page;
+        }
+
+        // bytes is a multiple of huge_page; nullptr if even plain pages fail
+        [[nodiscard]] static inline void* map(std::size_t bytes, bool hugetlb) noexcept
+        {
+#ifdef MAP_HUGETLB
+            if (hugetlb)
+            {
+                auto ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (ptr != MAP_FAILED)
+                    return ptr;
+            }
+#else
+            (void) hugetlb;
+#endif
+
+            // one huge page more than needed, then the unaligned ends go back
+            auto raw = mmap(nullptr, bytes + huge_page, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (raw == MAP_FAILED)
+                return nullptr;
+
+            auto address = reinterpret_cast<uintptr_t>(raw);
+            auto aligned = (address + huge_page - 1) & ~(uintptr_t(huge_page) - 1);
+            if (aligned != address)
+                munmap(raw, aligned - address);
+            munmap(reinterpret_cast<void*>(aligned + bytes), address + huge_page - aligned);
+
+            advise(reinterpret_cast<void*>(aligned), bytes);
+            return reinterpret_cast<void*>(aligned);
+        }
+
+        // a hint, kernels without THP just ignore it
+        static inline void advise(void* ptr, std::size_t bytes) noexcept
+        {
+#ifdef MADV_HUGEPAGE
+            madvise(ptr, bytes, MADV_HUGEPAGE);
+#else
+            (void) ptr;
+            (void) bytes;
+#endif
+        }
+
+        // grows the mapping where it is, false if the pages after it are taken
+        [[nodiscard]] static inline bool remap_in_place(void* ptr, std::size_t bytes, std::size_t new_bytes) noexcept
+        {
+            if (new_bytes <= bytes)
+                return true;
+
+            if (mremap(ptr, bytes, new_bytes, 0) == MAP_FAILED)
+                return false;
+
+            advise(static_cast<uint8_t*>(ptr) + bytes, new_bytes - bytes);
+            return true;
+        }
+
+        static inline void unmap(void* ptr, std::size_t bytes) noexcept
+        {
+            munmap(ptr, bytes);
+        }
+    };
+
+    // huge blocks from huge_pages, the rest from malloc; a block is huge
+    // iff its count covers huge_page bytes, so malloc blocks report less
+    template<typename T, bool raw_memory = true, bool HugeTLB = false>
+    class HugePages
+    {
+        static_assert(raw_memory, "HugePages: only raw memory!");
+        static_assert(sizeof(T) < huge_pages::huge_page, "HugePages: T is bigger than a huge page!");
+
+    protected:
+        static std::size_t constexpr small_limit_
+                                   = (huge_pages::huge_page - 1) / sizeof(T);
+
+        [[nodiscard]] static constexpr bool is_huge_(std::size_t n) noexcept
+        {
+            return n > small_limit_;
+        }
+
+    public:
+        static bool const is_empty = false;
+        static bool const is_raw   = raw_memory;
+        using value_type           = T;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+
+        template<typename U>
+        using rebind               = HugePages<U, raw_memory, HugeTLB>;
+
+        [[nodiscard]] inline value_type* allocate(size_type n)
+        {
+            return allocate_at_least(n).ptr;
+        }
+
+        [[nodiscard]] inline allocation_result<value_type> allocate_at_least(size_type n)
+        {
+            if (n == 0)
+                return { nullptr, 0 };
+
+            if (is_huge_(n))
+            {
+                auto bytes = huge_pages::round_up(n * sizeof(T));
+                auto ptr = huge_pages::map(bytes, HugeTLB);
+                if (ptr == nullptr)
+                    throw std::bad_alloc();
+
+                return { static_cast<value_type*>(ptr), bytes / sizeof(T) };
+            }
+
+            void* ptr = std::malloc(n * sizeof(T));
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+
+            auto count = usable_size(ptr, n * sizeof(T)) / sizeof(T);
+            return { static_cast<value_type*>(ptr), count < small_limit_ ? count : small_limit_ };
+        }
+
+        inline bool try_expand_in_place(value_type* ptr, size_type n, size_type new_n) noexcept
+        {
+            if (ptr == nullptr)
+                return false;
+
+            // malloc blocks already report their usable size, nothing more fits
+            if (!is_huge_(n))
+                return false;
+
+            return huge_pages::remap_in_place(ptr, huge_pages::round_up(n * sizeof(T)),
+                                              huge_pages::round_up(new_n * sizeof(T)));
+        }
+
+        inline void deallocate(value_type* ptr, size_type n) noexcept
+        {
+            if (ptr == nullptr)
+                return;
+
+            if (is_huge_(n))
+                huge_pages::unmap(ptr, huge_pages::round_up(n * sizeof(T)));
+            else
+                std::free(ptr);
+        }
+    };
+}
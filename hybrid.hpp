@@ -0,0 +1,286 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    hybrid.hpp
+
+Abstract:
+
+    Small buffer storage: first N elements live inline (like on_stack),
+    bigger capacities spill to an Allocator-backed heap block (like
+    on_heap) and come back inline when shrunk to N or less.
+
+        jules::vector<int, jules::allocator::Default<int, true>,
+                      jules::storage::hybrid<8>::type>
+
+    or just jules::small_vector<int, 8>.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "allocators.hpp"
+#include "traits.hpp"
+
+//
+// Defines
+//
+
+namespace jules::storage
+{
+    template<std::size_t N>
+    struct hybrid
+    {
+        template<typename T, std::size_t InitialCapacity, class Allocator = jules::allocator::Default<T, true>>
+        class type
+        {
+            static_assert(Allocator::is_raw, "storage::hybrid: allocator must be raw!");
+
+        public:
+            static bool const is_raw   = true;
+            static bool const is_stealable
+                                       = true;
+            static std::size_t const inline_capacity
+                                       = N;
+            static std::size_t const alignment
+                                       = jules::allocator::traits<Allocator>::alignment;
+            using value_type           = T;
+            using size_type            = std::size_t;
+            using difference_type      = std::ptrdiff_t;
+
+        protected:
+            using allocator_traits     = jules::allocator::traits<Allocator>;
+
+            alignas(alignment) unsigned char buffer_[N == 0 ? 1 : N * sizeof(T)];
+            Allocator allocator_;
+            value_type* data_;
+            size_type capacity_;
+
+            [[nodiscard]] inline value_type* buffer_data_() noexcept
+            {
+                return reinterpret_cast<value_type*>(buffer_);
+            }
+
+            // moves [from, from + count) of source into the same slots of destination
+            static void relocate_(value_type* destination, value_type* source,
+                                  size_type count, difference_type from)
+            {
+                if constexpr (jules::is_trivially_relocatable_v<value_type>)
+                {
+                    if (count != 0)
+                        std::memcpy(static_cast<void*>(destination + from),
+                                    static_cast<void const*>(source + from),
+                                    count * sizeof(value_type));
+                }
+
+                else
+                {
+                    for (difference_type i = from; i != from + static_cast<difference_type>(count); i++)
+                    {
+                        new (destination + i) value_type(std::move(source[i]));
+                        source[i].~value_type();
+                    }
+                }
+            }
+
+            void inline release_heap_() noexcept
+            {
+                if (!is_inline())
+                    allocator_.deallocate(data_, capacity_);
+
+                data_ = buffer_data_();
+                capacity_ = N;
+            }
+
+        public:
+            //
+            // Constructors / destructors
+            //
+
+            type() :
+                data_(buffer_data_()),
+                capacity_(N)
+            {
+                if (InitialCapacity > N)
+                    realloc(InitialCapacity);
+            }
+
+            type(type const&) = delete;
+            type& operator=(type const&) = delete;
+
+            ~type()
+            {
+                release_heap_();
+            }
+
+            //
+            // Element access
+            //
+
+            void inline create(difference_type index)
+            {
+                new (data_ + index) value_type();
+            }
+
+            // default-initialization, trivial types are left uninitialized
+            void inline create_for_overwrite(difference_type index)
+            {
+                new (data_ + index) value_type;
+            }
+
+            template<typename... Args>
+            void inline create(difference_type index, Args&&... args)
+            {
+                new (data_ + index) value_type(std::forward<Args>(args)...);
+            }
+
+            void inline destroy(difference_type index)
+            {
+                (data_ + index)->~value_type();
+            }
+
+            [[nodiscard]] inline value_type const& at_unchecked(difference_type index) const noexcept
+            {
+                return data_[index];
+            }
+
+            [[nodiscard]] inline value_type& at_unchecked(difference_type index) noexcept
+            {
+                return const_cast<value_type&>(static_cast<type const*>(this)->at_unchecked(index));
+            }
+
+            [[nodiscard]] inline value_type const* data() const noexcept
+            {
+                return data_;
+            }
+
+            [[nodiscard]] inline value_type* data() noexcept
+            {
+                return const_cast<value_type*>(static_cast<type const*>(this)->data());
+            }
+
+            //
+            // Capacity
+            //
+
+            [[nodiscard]] inline bool is_inline() const noexcept
+            {
+                return data_ == reinterpret_cast<value_type const*>(buffer_);
+            }
+
+            [[nodiscard]] inline size_type capacity() const noexcept
+            {
+                return capacity_;
+            }
+
+            // capacities up to N mean the inline buffer
+            void inline realloc(size_type new_capacity, size_type elements_to_move = 0, difference_type move_from = 0)
+            {
+                static_assert(std::is_move_constructible<value_type>::value);
+                if (new_capacity < move_from + elements_to_move)
+                    std::__throw_out_of_range_fmt("storage::hybrid::realloc: "
+                        "new capacity == %zu is less than move_from + elements_to_move == %zu",
+                        new_capacity, move_from + elements_to_move);
+
+                if (new_capacity <= N)
+                {
+                    if (is_inline())
+                        return;
+
+                    relocate_(buffer_data_(), data_, elements_to_move, move_from);
+                    release_heap_();
+                    return;
+                }
+
+                if (new_capacity == capacity_)
+                    return;
+
+                if (new_capacity > capacity_ && !is_inline() &&
+                    allocator_traits::try_expand_in_place(allocator_, data_, capacity_, new_capacity))
+                {
+                    capacity_ = new_capacity;
+                    return;
+                }
+
+                if constexpr (allocator_traits::can_reallocate && jules::is_trivially_relocatable_v<value_type>)
+                {
+                    if (!is_inline())
+                    {
+                        auto block = allocator_traits::reallocate(allocator_, data_, capacity_, new_capacity);
+                        data_ = block.ptr;
+                        capacity_ = block.count;
+                        return;
+                    }
+                }
+
+                auto block = allocator_traits::allocate_at_least(allocator_, new_capacity);
+                relocate_(block.ptr, data_, elements_to_move, move_from);
+                release_heap_();
+
+                data_ = block.ptr;
+                capacity_ = block.count;
+            }
+
+            // takes other`s heap block, or relocates its size inline elements,
+            // and other`s allocator either way; this must hold no elements
+            void inline steal(type& other, size_type size) noexcept(std::is_nothrow_move_constructible<value_type>::value)
+            {
+                if (this == &other)
+                    return;
+
+                release_heap_();
+                allocator_ = other.allocator_;
+                if (other.is_inline())
+                {
+                    relocate_(data_, other.data_, size, 0);
+                    return;
+                }
+
+                data_ = other.data_;
+                capacity_ = other.capacity_;
+
+                other.data_ = other.buffer_data_();
+                other.capacity_ = N;
+            }
+
+            void inline swap(type& other, size_type size, size_type other_size)
+                noexcept(std::is_nothrow_move_constructible<value_type>::value)
+            {
+                if (this == &other)
+                    return;
+
+                if (!is_inline() && !other.is_inline())
+                {
+                    std::swap(allocator_, other.allocator_);
+                    std::swap(data_, other.data_);
+                    std::swap(capacity_, other.capacity_);
+                    return;
+                }
+
+                type temporary;
+                temporary.steal(*this, size);
+                steal(other, other_size);
+                other.steal(temporary, size);
+            }
+        };
+    };
+}
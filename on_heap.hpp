@@ -26,11 +26,13 @@ Revision History:
 #pragma once
 #include <cassert>
 #include <cstddef>
+#include <cstring>
 #include <array>
 #include <stdexcept>
 #include <type_traits>
 
 #include "allocators.hpp"
+#include "traits.hpp"
 
 //
 // Defines
@@ -43,11 +45,17 @@ namespace jules::storage
     {
     public:
         static bool const is_raw   = Allocator::is_raw;
+        static bool const is_stealable
+                                   = true;
+        static std::size_t const alignment
+                                   = jules::allocator::traits<Allocator>::alignment;
         using value_type           = T;
         using size_type            = std::size_t;
         using difference_type      = std::ptrdiff_t;
 
     protected:
+        using allocator_traits     = jules::allocator::traits<Allocator>;
+
         Allocator allocator_;
         value_type* data_;
         size_type capacity_;
@@ -57,10 +65,11 @@ namespace jules::storage
         // Constructors / destructors
         // 
 
-        on_heap() :
-            data_(allocator_.allocate(InitialCapacity)),
-            capacity_(InitialCapacity)
+        on_heap()
         {
+            auto block = allocator_traits::allocate_at_least(allocator_, InitialCapacity);
+            data_ = block.ptr;
+            capacity_ = block.count;
         }
 
         ~on_heap()
@@ -77,6 +86,12 @@ namespace jules::storage
             new (data_ + index) value_type();
         }
 
+        // default-initialization, trivial types are left uninitialized
+        void inline create_for_overwrite(difference_type index)
+        {
+            new (data_ + index) value_type;
+        }
+
         template<typename... Args>
         void inline create(difference_type index, Args&&... args)
         {
@@ -128,10 +143,48 @@ namespace jules::storage
                     "new capacity == %zu is less than move_from + elements_to_move == %zu",
                     new_capacity, move_from + elements_to_move);
 
-            // value_type* new_data = reinterpret_cast<value_type*>(new uint8_t[new_capacity * sizeof(value_type)]);
-            value_type* new_data = allocator_.allocate(new_capacity);
+            // growing into the slack of the current block costs nothing
+            if (new_capacity > capacity_ && 
+                allocator_traits::try_expand_in_place(allocator_, data_, capacity_, new_capacity))
+            {
+                capacity_ = new_capacity;
+                return;
+            }
+
+            // realloc style allocators move the bytes themselves, and often
+            // don`t have to, when the block can grow where it is
+            if constexpr (allocator_traits::can_reallocate && is_raw &&
+                          jules::is_trivially_relocatable_v<value_type>)
+            {
+                if (data_ != nullptr && new_capacity != 0)
+                {
+                    auto block = allocator_traits::reallocate(allocator_, data_, capacity_, new_capacity);
+                    data_ = block.ptr;
+                    capacity_ = block.count;
+                    return;
+                }
+            }
+
+            // capacity_ becomes what the allocator really gave, may be > new_capacity
+            auto block = allocator_traits::allocate_at_least(allocator_, new_capacity);
+            value_type* new_data = block.ptr;
+            new_capacity = block.count;
 
-            for (int i = move_from; i != move_from + elements_to_move; i++)
+            if (is_raw && jules::is_trivially_relocatable_v<value_type>)
+            {
+                // whole block at once, no per-element move + destroy
+                if (elements_to_move != 0)
+                    std::memcpy(static_cast<void*>(new_data + move_from),
+                                static_cast<void const*>(data_ + move_from),
+                                elements_to_move * sizeof(value_type));
+
+                allocator_.deallocate(data_, capacity_);
+                data_ = new_data;
+                capacity_ = new_capacity;
+                return;
+            }
+
+            for (difference_type i = move_from; i != move_from + elements_to_move; i++)
             {
                 // only way to do this???
                 // can`t just copy, cause fields may depend on this
@@ -147,8 +200,25 @@ namespace jules::storage
             capacity_ = new_capacity;
         }
 
-        void inline swap(on_heap& other)
+        // takes other`s buffer and the allocator that owns it,
+        // other is left with no buffer at all
+        void inline steal(on_heap& other, size_type /* size */ = 0) noexcept
+        {
+            if (this == &other)
+                return;
+
+            allocator_.deallocate(data_, capacity_);
+            allocator_ = other.allocator_;
+            data_ = other.data_;
+            capacity_ = other.capacity_;
+
+            other.data_ = nullptr;
+            other.capacity_ = 0;
+        }
+
+        void inline swap(on_heap& other, size_type /* size */ = 0, size_type /* other_size */ = 0) noexcept
         {
+            std::swap(allocator_, other.allocator_);
             std::swap(data_, other.data_);
             std::swap(capacity_, other.capacity_);
         }
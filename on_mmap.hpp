@@ -0,0 +1,213 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    on_mmap.hpp
+
+Abstract:
+
+    Storage in anonymous mmap regions for huge vectors of trivially
+    relocatable types. Growth remaps pages (mremap with MREMAP_MAYMOVE)
+    instead of copying them, shrinking gives pages back to the OS.
+
+    Linux only. Capacity is always a whole number of pages, so don`t use
+    it for small vectors. Allocator is accepted for interface compatibility
+    and ignored.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "allocators.hpp"
+#include "traits.hpp"
+
+//
+// Defines
+//
+
+namespace jules::storage
+{
+    template<typename T, std::size_t InitialCapacity, class Allocator = jules::allocator::Default<T, true>>
+    class on_mmap
+    {
+        static_assert(jules::is_trivially_relocatable_v<T>,
+            "storage::on_mmap: pages are remapped, T must be trivially relocatable!");
+
+    public:
+        static bool const is_raw   = true;
+        static bool const is_stealable
+                                   = true;
+        static std::size_t const alignment
+                                   = 4096;         // whole pages, at least 4 KB anywhere
+        using value_type           = T;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+
+    protected:
+        value_type* data_ = nullptr;
+        size_type capacity_ = 0;
+
+        static size_type page_size_() noexcept
+        {
+            static size_type const page_size = static_cast<size_type>(sysconf(_SC_PAGESIZE));
+            return page_size;
+        }
+
+        static size_type bytes_(size_type capacity) noexcept
+        {
+            auto page = page_size_();
+            return (capacity * sizeof(value_type) + page - 1) / page * page;
+        }
+
+        void inline unmap_() noexcept
+        {
+            if (data_ != nullptr)
+                munmap(data_, bytes_(capacity_));
+
+            data_ = nullptr;
+            capacity_ = 0;
+        }
+
+    public:
+        //
+        // Constructors / destructors
+        //
+
+        on_mmap()
+        {
+            realloc(InitialCapacity);
+        }
+
+        on_mmap(on_mmap const&) = delete;
+        on_mmap& operator=(on_mmap const&) = delete;
+
+        ~on_mmap()
+        {
+            unmap_();
+        }
+
+        //
+        // Element access
+        //
+
+        void inline create(difference_type index)
+        {
+            new (data_ + index) value_type();
+        }
+
+        // default-initialization, trivial types are left uninitialized
+        void inline create_for_overwrite(difference_type index)
+        {
+            new (data_ + index) value_type;
+        }
+
+        template<typename... Args>
+        void inline create(difference_type index, Args&&... args)
+        {
+            new (data_ + index) value_type(std::forward<Args>(args)...);
+        }
+
+        void inline destroy(difference_type index)
+        {
+            (data_ + index)->~value_type();
+        }
+
+        [[nodiscard]] inline value_type const& at_unchecked(difference_type index) const noexcept
+        {
+            return data_[index];
+        }
+
+        [[nodiscard]] inline value_type& at_unchecked(difference_type index) noexcept
+        {
+            return const_cast<value_type&>(static_cast<on_mmap const*>(this)->at_unchecked(index));
+        }
+
+        [[nodiscard]] inline value_type const* data() const noexcept
+        {
+            return data_;
+        }
+
+        [[nodiscard]] inline value_type* data() noexcept
+        {
+            return const_cast<value_type*>(static_cast<on_mmap const*>(this)->data());
+        }
+
+        //
+        // Capacity
+        //
+
+        [[nodiscard]] inline size_type capacity() const noexcept
+        {
+            return capacity_;
+        }
+
+        // elements keep their offsets, so nothing is moved by hand
+        void inline realloc(size_type new_capacity, size_type elements_to_move = 0, difference_type move_from = 0)
+        {
+            if (new_capacity < move_from + elements_to_move)
+                std::__throw_out_of_range_fmt("storage::on_mmap::realloc: "
+                    "new capacity == %zu is less than move_from + elements_to_move == %zu",
+                    new_capacity, move_from + elements_to_move);
+
+            auto new_bytes = bytes_(new_capacity);
+            if (new_bytes == 0)
+            {
+                unmap_();
+                return;
+            }
+
+            if (data_ != nullptr && new_bytes == bytes_(capacity_))
+                return;
+
+            void* new_data = (data_ == nullptr) ?
+                mmap(nullptr, new_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) :
+                mremap(data_, bytes_(capacity_), new_bytes, MREMAP_MAYMOVE);
+
+            if (new_data == MAP_FAILED)
+                throw std::bad_alloc();
+
+            data_ = static_cast<value_type*>(new_data);
+            capacity_ = new_bytes / sizeof(value_type);
+        }
+
+        // takes other`s mapping, other is left with no mapping at all
+        void inline steal(on_mmap& other, size_type /* size */ = 0) noexcept
+        {
+            if (this == &other)
+                return;
+
+            unmap_();
+            data_ = other.data_;
+            capacity_ = other.capacity_;
+
+            other.data_ = nullptr;
+            other.capacity_ = 0;
+        }
+
+        void inline swap(on_mmap& other, size_type /* size */ = 0, size_type /* other_size */ = 0) noexcept
+        {
+            std::swap(data_, other.data_);
+            std::swap(capacity_, other.capacity_);
+        }
+    };
+}
@@ -8,7 +8,14 @@ Module Name:
 
 Abstract:
 
-    Stack storage 
+    Stack storage. Capacity is MaxSize and fixed, no allocator is ever
+    called. Asking for more is handled by the Overflow policy.
+
+    Storage template for vector is storage::fixed<N, Overflow>::type
+    (vector passes its own initial capacity 0, not N).
+
+    Alignment over-aligns the buffer (32 for AVX loads, 64 to keep it
+    off its neighbours` cache lines); below alignof(T) it means alignof(T).
 
 Author / Creation date:
 
@@ -27,7 +34,10 @@ Revision History:
 #include <cstddef>
 #include <array>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include "on_heap.hpp"
+#include "overflow.hpp"
 
 //
 // Defines
@@ -35,11 +45,23 @@ Revision History:
 
 namespace jules::storage
 {
-    template<typename T, size_t MaxSize, class Allocator = jules::allocator::Empty<T>>
+    template<typename T, size_t MaxSize, class Allocator = jules::allocator::Empty<T>,
+                         class Overflow = jules::overflow::throws, size_t Alignment = alignof(T)>
     class on_stack
     {
+    public:
+        static bool const is_raw   = true;
+        static bool const is_stealable
+                                   = false;
+        static size_t const alignment
+                                   = Alignment > alignof(T) ? Alignment : alignof(T);
+        using value_type           = T;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+        using overflow_policy      = Overflow;
+
     protected:
-        alignas(T) unsigned char buffer_[MaxSize * sizeof(T)];
+        alignas(alignment) unsigned char buffer_[MaxSize * sizeof(T)];
         T* const data_;
     
     public:
@@ -61,6 +83,12 @@ namespace jules::storage
             new (data_ + index) T();
         }
 
+        // default-initialization, trivial types are left uninitialized
+        void create_for_overwrite(size_t index)
+        {
+            new (data_ + index) T;
+        }
+
         template<typename... U>
         void create(size_t index, U&&... value)
         {
@@ -91,5 +119,49 @@ namespace jules::storage
         {
             return const_cast<T*>(static_cast<on_stack const*>(this)->data());
         }
+
+        [[nodiscard]] static constexpr size_type capacity() noexcept
+        {
+            return MaxSize;
+        }
+
+        // elements never move; capacity can`t change, so asking for more
+        // than MaxSize is an overflow and anything up to it is a no-op
+        void inline realloc(size_type new_capacity, size_type /* elements_to_move */ = 0, 
+                            difference_type /* move_from */ = 0)
+        {
+            if (new_capacity > MaxSize)
+                overflow_policy::overflow(MaxSize, new_capacity);
+        }
+
+        // element-wise, buffers can`t be exchanged
+        void inline swap(on_stack& other, size_type size, size_type other_size)
+        {
+            if (this == &other)
+                return;
+
+            if (size < other_size)
+            {
+                other.swap(*this, other_size, size);
+                return;
+            }
+
+            using std::swap;
+            for (size_type i = 0; i != other_size; i++)
+                swap(data_[i], other.data_[i]);
+
+            for (size_type i = other_size; i != size; i++)
+            {
+                other.create(i, std::move(data_[i]));
+                destroy(i);
+            }
+        }
+    };
+
+    template<size_t N, class Overflow = jules::overflow::throws, size_t Alignment = 0>
+    struct fixed
+    {
+        template<typename T, size_t /* InitialCapacity */, class Allocator>
+        using type = on_stack<T, N, Allocator, Overflow, Alignment>;
     };
 }
\ No newline at end of file
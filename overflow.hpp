@@ -0,0 +1,69 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    overflow.hpp
+
+Abstract:
+
+    What fixed capacity storages do when asked for more than they hold.
+
+    A policy is a type with one static function:
+
+        overflow(capacity, required)
+
+    It may throw, the storage is left untouched otherwise and the
+    container drops whatever did not fit.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+
+//
+// Defines
+//
+
+namespace jules::overflow
+{
+    // std::length_error, like std::vector past max_size()
+    struct throws
+    {
+        [[noreturn]] static void overflow(std::size_t /* capacity */, std::size_t /* required */)
+        {
+            std::__throw_length_error("overflow::throws: fixed capacity exceeded");
+        }
+    };
+
+    // overflow is a bug: checked in debug builds, dropped with NDEBUG
+    struct asserts
+    {
+        static void overflow(std::size_t /* capacity */, std::size_t /* required */) noexcept
+        {
+            assert(!"fixed capacity overflow");
+        }
+    };
+
+    // elements that don`t fit are silently dropped
+    struct drops
+    {
+        static void overflow(std::size_t /* capacity */, std::size_t /* required */) noexcept
+        {
+        }
+    };
+}
@@ -0,0 +1,625 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    packed_vector.hpp
+
+Abstract:
+
+    Vector of Bits-bit unsigned integers (1 <= Bits <= 32), packed back
+    to back into uint64 words the way vector<bool> packs bits: element i
+    takes bits [i * Bits, (i + 1) * Bits) of the word array, so it may
+    straddle two words. Access goes through proxy references like
+    vector<bool>`s, values are truncated to Bits bits like a bit-field.
+
+        jules::packed_vector<12> v;     // 12 bits per element instead of 32
+
+    Bulk conversion to and from uint32_t is vectorized with AVX2: every
+    8 elements take exactly Bits bytes, so unpack is one shuffle and one
+    variable shift per 8 elements (Bits <= 25, wider ones go scalar);
+    pack merges element pairs in 64-bit lanes and streams them out.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+#include "bits.hpp"
+#include "vector.hpp"
+
+//
+// Defines
+//
+
+namespace jules
+{
+    template<std::size_t Bits, class Allocator = jules::allocator::Default<uint64_t, true>,
+                               template<typename, size_t, class> class Storage = jules::storage::on_heap,
+                               class Growth = jules::growth::doubling>
+    class packed_vector
+    {
+        static_assert(Bits >= 1 && Bits <= 32, "packed_vector: Bits must be in [1, 32]!");
+        static_assert(Allocator::is_raw, "Allocator for packed_vector must be raw!");
+
+    public:
+        using value_type           = uint32_t;
+        using word_type            = jules::bits::word_type;
+        using allocator_type       = Allocator;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+        static size_type const initial_capacity
+                                   = 0;
+        using storage_type         = Storage<word_type, initial_capacity, allocator_type>;
+        using growth_policy        = Growth;
+        static size_type const bits_per_element
+                                   = Bits;
+        static value_type const max_value
+                                   = static_cast<value_type>((uint64_t(1) << Bits) - 1);
+
+    protected:
+        static word_type const mask_
+                                   = (word_type(1) << Bits) - 1;
+        static size_type const word_bits_
+                                   = jules::bits::word_bits;
+
+        // element at bit offset of *word, reads word[1] if it straddles
+        [[nodiscard]] static inline value_type load_(word_type const* word, size_type offset) noexcept
+        {
+            auto value = word[0] >> offset;
+            if (offset + Bits > word_bits_)
+                value |= word[1] << (word_bits_ - offset);
+
+            return static_cast<value_type>(value & mask_);
+        }
+
+        static inline void store_(word_type* word, size_type offset, value_type value) noexcept
+        {
+            auto bits = value & mask_;
+            word[0] = (word[0] & ~(mask_ << offset)) | (bits << offset);
+            if (offset + Bits > word_bits_)
+            {
+                auto spill = word_bits_ - offset;
+                word[1] = (word[1] & ~(mask_ >> spill)) | (bits >> spill);
+            }
+        }
+
+    struct __packed_ref
+    {
+        friend class packed_vector;
+        __packed_ref(__packed_ref const&) = default; // not explicit
+
+        __packed_ref& operator=(value_type value) noexcept
+        {
+            store_(word_, offset_, value);
+            return *this;
+        }
+
+        __packed_ref& operator=(__packed_ref const& other) noexcept
+        {
+            *this = value_type(other);
+            return *this;
+        }
+
+        operator value_type() const noexcept
+        {
+            return load_(word_, offset_);
+        }
+
+    private:
+        __packed_ref(word_type* word, size_type offset) noexcept :
+            word_(word), offset_(offset)
+        {
+        }
+
+        static __packed_ref create_(word_type* data, size_type index)
+        {
+            return __packed_ref(data + index * Bits / word_bits_, index * Bits % word_bits_);
+        }
+
+    private:
+            word_type* word_;
+            size_type const offset_;
+    };
+
+    struct __packed_const_ref
+    {
+        friend class packed_vector;
+        __packed_const_ref(__packed_const_ref const&) = default; // not explicit
+
+        operator value_type() const noexcept
+        {
+            return load_(word_, offset_);
+        }
+
+    private:
+        __packed_const_ref(word_type const* word, size_type offset) noexcept :
+            word_(word), offset_(offset)
+        {
+        }
+
+        static __packed_const_ref create_(word_type const* data, size_type index)
+        {
+            return __packed_const_ref(data + index * Bits / word_bits_, index * Bits % word_bits_);
+        }
+
+    private:
+            word_type const* word_;
+            size_type const offset_;
+    };
+
+    public:
+        using reference            = __packed_ref;
+        using const_reference      = __packed_const_ref;
+
+    protected:
+        storage_type storage_;
+        size_type size_ = 0;
+
+        // bits past size_ * Bits in the last word are always zero
+
+        static inline size_type words_number_(size_type elements) noexcept
+        {
+            return jules::bits::words_number(elements * Bits);
+        }
+
+        inline void check_index_(size_type index, char const* fnc) const
+        {
+            if (index >= size_)
+                std::__throw_out_of_range_fmt("%s: "
+                    "index == %zu out of range within size == %zu",
+                    fnc, index, size_);
+        }
+
+        inline void check_range_(size_type first, size_type count, char const* fnc) const
+        {
+            if (first > size_ || count > size_ - first)
+                std::__throw_out_of_range_fmt("%s: "
+                    "[%zu, %zu + %zu) out of range within size == %zu",
+                    fnc, first, first, count, size_);
+        }
+
+        inline void realloc_if_needed_(size_type count = 1)
+        {
+            auto current_capacity = storage_.capacity();
+            auto new_words = words_number_(size_ + count);
+            if (new_words <= current_capacity)
+                return;
+
+            storage_.realloc(growth_policy::grow(current_capacity, new_words, sizeof(word_type)),
+                             words_number_(size_));
+        }
+
+        // call after size_ went down
+        inline void shrink_if_needed_()
+        {
+            auto current_capacity = storage_.capacity();
+            auto words = words_number_(size_);
+            auto new_capacity = growth_policy::shrink(current_capacity, words, sizeof(word_type));
+            if (new_capacity < current_capacity)
+                storage_.realloc(new_capacity, words);
+        }
+
+        inline void clear_tail_() noexcept
+        {
+            if (size_ * Bits % word_bits_ != 0)
+                word_data()[size_ * Bits / word_bits_] &= jules::bits::tail_mask(size_ * Bits);
+        }
+
+        // size_ must be 0
+        inline void copy_words_(packed_vector const& origin)
+        {
+            reserve(origin.size_);
+            if (origin.size_ != 0)
+                std::memcpy(static_cast<void*>(word_data()), static_cast<void const*>(origin.word_data()),
+                            words_number_(origin.size_) * sizeof(word_type));
+            size_ = origin.size_;
+        }
+
+        // packs count values after the last element, capacity must be enough
+        inline void pack_(value_type const* values, size_type count) noexcept
+        {
+            auto position = size_ * Bits;
+            auto out = word_data() + position / word_bits_;
+            auto fill = position % word_bits_;
+            word_type accumulator = fill != 0 ? *out : 0;
+
+            // chunk of width <= 64 bits into the stream
+            auto put = [&](word_type chunk, size_type width)
+            {
+                accumulator |= chunk << fill;
+                if (fill + width < word_bits_)
+                {
+                    fill += width;
+                    return;
+                }
+
+                *out++ = accumulator;
+                accumulator = fill != 0 ? chunk >> (word_bits_ - fill) : 0;
+                fill = fill + width - word_bits_;
+            };
+
+            size_type i = 0;
+#ifdef __AVX2__
+            // pairs of elements merged in 64-bit lanes: (low | high << Bits)
+            auto const mask = _mm256_set1_epi64x(static_cast<long long>(mask_ | (mask_ << 32)));
+            auto const low = _mm256_set1_epi64x(static_cast<long long>(mask_));
+            alignas(32) word_type pairs[4];
+            for (; i + 8 <= count; i += 8)
+            {
+                auto v = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<__m256i const*>(values + i)), mask);
+                auto merged = _mm256_or_si256(_mm256_and_si256(v, low),
+                                              _mm256_andnot_si256(low, _mm256_srli_epi64(v, 32 - Bits)));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(pairs), merged);
+                for (size_type k = 0; k != 4; k++)
+                    put(pairs[k], 2 * Bits);
+            }
+#endif
+            for (; i != count; i++)
+                put(values[i] & mask_, Bits);
+
+            if (fill != 0)
+                *out = accumulator;
+
+            size_ += count;
+        }
+
+#ifdef __AVX2__
+        // byte shuffle and shifts for 8 elements of one group: lanes 0..3 read
+        // the group`s first 16 bytes, lanes 4..7 the 16 bytes from byte Bits / 2
+        struct unpack_controls_
+        {
+            alignas(32) int8_t shuffle[32];
+            alignas(32) int32_t shifts[8];
+
+            unpack_controls_() noexcept
+            {
+                for (size_type lane = 0; lane != 8; lane++)
+                {
+                    auto bit = lane * Bits;
+                    auto base = (lane < 4) ? 0 : Bits / 2;
+                    for (size_type byte = 0; byte != 4; byte++)
+                        shuffle[lane * 4 + byte] = static_cast<int8_t>(bit / 8 - base + byte);
+
+                    shifts[lane] = static_cast<int32_t>(bit % 8);
+                }
+            }
+        };
+#endif
+
+    public:
+        //
+        // Constructors / destructors
+        //
+
+        explicit packed_vector(size_type size = 0, value_type value = 0)
+        {
+            assign(size, value);
+        }
+
+        // not explicit!
+        packed_vector(std::initializer_list<value_type> list)
+        {
+            append(list.begin(), list.size());
+        }
+
+        // pointers only, so packed_vector(0, 5) means size and value
+        template<typename Pointer, typename = std::enable_if_t<std::is_pointer_v<Pointer>>>
+        packed_vector(Pointer values, size_type count)
+        {
+            append(values, count);
+        }
+
+        packed_vector(packed_vector const& origin)
+        {
+            copy_words_(origin);
+        }
+
+        packed_vector(packed_vector&& origin) noexcept(storage_type::is_stealable)
+        {
+            if constexpr (storage_type::is_stealable)
+            {
+                storage_.steal(origin.storage_, words_number_(origin.size_));
+                size_ = origin.size_;
+                origin.size_ = 0;
+            }
+
+            else
+                copy_words_(origin);
+        }
+
+        ~packed_vector() noexcept
+        {
+            clear();
+        }
+
+        packed_vector& operator=(packed_vector const& origin)
+        {
+            if (this == &origin)
+                return *this;
+
+            clear();
+            copy_words_(origin);
+            return *this;
+        }
+
+        packed_vector& operator=(packed_vector&& origin) noexcept(storage_type::is_stealable)
+        {
+            if (this == &origin)
+                return *this;
+
+            clear();
+            if constexpr (storage_type::is_stealable)
+            {
+                storage_.steal(origin.storage_, words_number_(origin.size_));
+                size_ = origin.size_;
+                origin.size_ = 0;
+            }
+
+            else
+                copy_words_(origin);
+
+            return *this;
+        }
+
+        inline void assign(size_type count, value_type value)
+        {
+            clear();
+            reserve(count);
+            for (size_type i = 0; i != words_number_(count); i++)
+                word_data()[i] = 0;
+
+            size_ = count;
+            if (value & mask_)
+                for (size_type i = 0; i != count; i++)
+                    at_unchecked(i) = value;
+        }
+
+        //
+        // Element access
+        //
+
+        [[nodiscard]] inline const_reference at_unchecked(size_type index) const noexcept
+        {
+            return __packed_const_ref::create_(storage_.data(), index);
+        }
+
+        [[nodiscard]] inline reference at_unchecked(size_type index) noexcept
+        {
+            return __packed_ref::create_(storage_.data(), index);
+        }
+
+        [[nodiscard]] inline const_reference operator[](size_type index) const
+        {
+            check_index_(index, "packed_vector::operator[](size_t)");
+            return at_unchecked(index);
+        }
+
+        [[nodiscard]] inline reference operator[](size_type index)
+        {
+            check_index_(index, "packed_vector::operator[](size_t)");
+            return at_unchecked(index);
+        }
+
+        [[nodiscard]] inline const_reference front() const
+        {
+            return operator[](0);
+        }
+
+        [[nodiscard]] inline reference front()
+        {
+            return operator[](0);
+        }
+
+        [[nodiscard]] inline const_reference back() const
+        {
+            return operator[](size_ - 1);
+        }
+
+        [[nodiscard]] inline reference back()
+        {
+            return operator[](size_ - 1);
+        }
+
+        // element i is bits [i * Bits, (i + 1) * Bits) of the words
+        [[nodiscard]] inline word_type const* word_data() const noexcept
+        {
+            return storage_.data();
+        }
+
+        [[nodiscard]] inline word_type* word_data() noexcept
+        {
+            return const_cast<word_type*>(static_cast<packed_vector const*>(this)->word_data());
+        }
+
+        [[nodiscard]] inline size_type word_count() const noexcept
+        {
+            return words_number_(size_);
+        }
+
+        //
+        // Bulk conversion
+        //
+
+        // [first, first + count) into out
+        inline void unpack(size_type first, size_type count, value_type* out) const
+        {
+            check_range_(first, count, "packed_vector::unpack(size_t, size_t, value_type*)");
+            auto words = word_data();
+            auto last = first + count;
+
+#ifdef __AVX2__
+            if constexpr (Bits <= 25)
+            {
+                // scalar up to a group boundary, then whole groups while
+                // both 16 byte loads stay inside the used words
+                for (; first != last && first % 8 != 0; first++)
+                    *out++ = at_unchecked(first);
+
+                static unpack_controls_ const controls;
+                auto const shuffle = _mm256_load_si256(reinterpret_cast<__m256i const*>(controls.shuffle));
+                auto const shifts = _mm256_load_si256(reinterpret_cast<__m256i const*>(controls.shifts));
+                auto const mask = _mm256_set1_epi32(static_cast<int>(mask_));
+
+                auto bytes = reinterpret_cast<uint8_t const*>(words);
+                auto available = word_count() * sizeof(word_type);
+                for (; first + 8 <= last && first / 8 * Bits + Bits / 2 + 16 <= available; first += 8, out += 8)
+                {
+                    auto group = bytes + first / 8 * Bits;
+                    auto low = _mm_loadu_si128(reinterpret_cast<__m128i const*>(group));
+                    auto high = _mm_loadu_si128(reinterpret_cast<__m128i const*>(group + Bits / 2));
+                    auto v = _mm256_shuffle_epi8(_mm256_set_m128i(high, low), shuffle);
+                    v = _mm256_and_si256(_mm256_srlv_epi32(v, shifts), mask);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+                }
+            }
+#endif
+            for (; first != last; first++)
+                *out++ = load_(words + first * Bits / word_bits_, first * Bits % word_bits_);
+        }
+
+        [[nodiscard]] inline jules::vector<value_type> unpack() const
+        {
+            jules::vector<value_type> result;
+            if (size_ != 0)
+                unpack(0, size_, result.reserve_and_expose(size_));
+
+            return result;
+        }
+
+        inline void append(value_type const* values, size_type count)
+        {
+            realloc_if_needed_(count);
+            pack_(values, count);
+        }
+
+        inline void append(jules::vector<value_type> const& values)
+        {
+            append(values.data(), values.size());
+        }
+
+        //
+        // Capacity
+        //
+
+        [[nodiscard]] inline bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        [[nodiscard]] inline size_type size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] inline size_type max_size() const noexcept
+        {
+            return std::numeric_limits<size_type>::max() / Bits;
+        }
+
+        inline void reserve(size_type new_capacity)
+        {
+            if (new_capacity > capacity())
+                storage_.realloc(words_number_(new_capacity), words_number_(size_));
+        }
+
+        [[nodiscard]] inline size_type capacity() const noexcept
+        {
+            return storage_.capacity() * word_bits_ / Bits;
+        }
+
+        inline void shrink_to_fit()
+        {
+            storage_.realloc(words_number_(size_), words_number_(size_));
+        }
+
+        //
+        // Modifiers
+        //
+
+        inline void clear() noexcept
+        {
+            size_ = 0;
+        }
+
+        inline void resize(size_type new_size, value_type value = 0)
+        {
+            if (new_size <= size_)
+            {
+                size_ = new_size;
+                clear_tail_();
+                shrink_if_needed_();
+                return;
+            }
+
+            realloc_if_needed_(new_size - size_);
+            auto words = word_data();
+            for (auto i = words_number_(size_); i < words_number_(new_size); i++)
+                words[i] = 0;
+
+            auto old_size = size_;
+            size_ = new_size;
+            if (value & mask_)
+                for (auto i = old_size; i != new_size; i++)
+                    at_unchecked(i) = value;
+        }
+
+        inline void push_back(value_type value)
+        {
+            realloc_if_needed_();
+            for (auto i = words_number_(size_); i < words_number_(size_ + 1); i++)
+                word_data()[i] = 0;
+
+            size_++;
+            at_unchecked(size_ - 1) = value;
+        }
+
+        inline void pop_back()
+        {
+            check_index_(0, "packed_vector::pop_back()");
+            size_--;
+            clear_tail_();
+            shrink_if_needed_();
+        }
+
+        inline void swap(packed_vector& other) noexcept(storage_type::is_stealable)
+        {
+            storage_.swap(other.storage_, words_number_(size_), words_number_(other.size_));
+            std::swap(size_, other.size_);
+        }
+
+        //
+        // Comparison
+        //
+
+        [[nodiscard]] friend inline bool operator==(packed_vector const& lhs, packed_vector const& rhs) noexcept
+        {
+            return lhs.size_ == rhs.size_ &&
+                   (lhs.size_ == 0 || std::memcmp(lhs.word_data(), rhs.word_data(),
+                                                  lhs.word_count() * sizeof(word_type)) == 0);
+        }
+
+        [[nodiscard]] friend inline bool operator!=(packed_vector const& lhs, packed_vector const& rhs) noexcept
+        {
+            return !(lhs == rhs);
+        }
+    };
+}
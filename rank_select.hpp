@@ -0,0 +1,275 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    rank_select.hpp
+
+Abstract:
+
+    Rank / select index over the words of a bit container
+    (vector<bool>, array<bool>):
+
+        rank(i)   - number of ones in [0, i)
+        select(k) - position of the k-th one (from 0), size() if k >= ones()
+
+    Layout: absolute counts every 2^16 bits, 16-bit counts relative to
+    them every 512 bits (3.1% of the bits) and the block of every 8192-th
+    one for select (at most 0.4%). rank is two lookups plus at most eight
+    popcounts, select is a binary search between two samples plus the
+    same scan.
+
+    The index reads the container`s words and does not own them: any
+    mutation of the container invalidates it, call rebuild() after.
+    Built from a container, it shares the container`s bits::watch, so
+    is_fresh() / is_built_for() catch resizing, reallocation, words
+    handed out through word_data() and the container`s death, and with
+    JULES_CHECKED_ITERATORS a query on a stale index throws instead of
+    reading freed words. Single bit writes through a reference are not
+    counted, they would pay a store each. Built from raw words it
+    cannot tell.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "bits.hpp"
+#include "vector.hpp"
+
+//
+// Defines
+//
+
+namespace jules
+{
+    class rank_select
+    {
+    public:
+        using word_type            = jules::bits::word_type;
+        using size_type            = std::size_t;
+
+        static size_type const block_bits
+                                   = 512;
+        static size_type const super_bits
+                                   = 1 << 16;
+        static size_type const select_sample
+                                   = 8192;
+
+    protected:
+        static size_type const block_words_
+                                   = block_bits / jules::bits::word_bits;
+        static size_type const blocks_per_super_
+                                   = super_bits / block_bits;
+
+        word_type const* words_ = nullptr;
+        size_type size_ = 0;
+        size_type ones_ = 0;
+
+        // container`s watch() and its generation at rebuild, null for raw words
+        std::shared_ptr<jules::bits::watch const> watch_;
+        size_type generation_ = 0;
+
+        jules::vector<uint64_t> super_;     // ones before each superblock
+        jules::vector<uint16_t> blocks_;    // ones before each block within its superblock
+        jules::vector<uint32_t> samples_;   // block of every select_sample-th one
+
+        [[nodiscard]] inline size_type rank_of_block_(size_type block) const noexcept
+        {
+            return super_.at_unchecked(block / blocks_per_super_) + blocks_.at_unchecked(block);
+        }
+
+        [[nodiscard]] inline size_type word_count_() const noexcept
+        {
+            return jules::bits::words_number(size_);
+        }
+
+        template<class Bits, typename = void>
+        struct has_watch_ : std::false_type {};
+
+        template<class Bits>
+        struct has_watch_<Bits, std::void_t<decltype(std::declval<Bits const&>().watch())>> :
+            std::true_type {};
+
+        inline void check_fresh_(char const* fnc) const
+        {
+#ifdef JULES_CHECKED_ITERATORS
+            if (!is_fresh())
+                std::__throw_logic_error(fnc);
+#else
+            (void) fnc;
+#endif
+        }
+
+        static bool const checked_
+#ifdef JULES_CHECKED_ITERATORS
+                                   = true;
+#else
+                                   = false;
+#endif
+
+    public:
+        rank_select() = default;
+
+        template<class Bits>
+        explicit rank_select(Bits const& bits)
+        {
+            rebuild(bits);
+        }
+
+        template<class Bits>
+        inline void rebuild(Bits const& bits)
+        {
+            rebuild(bits.word_data(), bits.size());
+            if constexpr (has_watch_<Bits>::value)
+            {
+                watch_ = bits.watch();
+                generation_ = watch_->generation;
+            }
+        }
+
+        // bits past size in the last word must be zero
+        inline void rebuild(word_type const* words, size_type size)
+        {
+            words_ = words;
+            size_ = size;
+            watch_.reset();
+
+            auto blocks = size / block_bits + 1;
+            super_.clear();
+            super_.resize(blocks / blocks_per_super_ + 1);
+            blocks_.clear();
+            blocks_.resize(blocks);
+            samples_.clear();
+
+            size_type total = 0;
+            for (size_type block = 0; block != blocks; block++)
+            {
+                if (block % blocks_per_super_ == 0)
+                    super_.at_unchecked(block / blocks_per_super_) = total;
+
+                auto in_block = total - super_.at_unchecked(block / blocks_per_super_);
+                blocks_.at_unchecked(block) = static_cast<uint16_t>(in_block);
+
+                auto first = block * block_words_;
+                auto last = std::min(first + block_words_, word_count_());
+                for (auto i = first; i < last; i++)
+                {
+                    auto ones = jules::bits::popcount(words_[i]);
+
+                    // next sample falls into this word
+                    auto next = samples_.size() * select_sample;
+                    if (next < total + ones)
+                        samples_.push_back(static_cast<uint32_t>(block));
+
+                    total += ones;
+                }
+            }
+
+            ones_ = total;
+        }
+
+        template<class Bits>
+        [[nodiscard]] inline bool is_built_for(Bits const& bits) const noexcept
+        {
+            return bits.word_data() == words_ && bits.size() == size_ && is_fresh();
+        }
+
+        // false once the container may have changed since rebuild() or is
+        // gone; always true when built from raw words
+        [[nodiscard]] inline bool is_fresh() const noexcept
+        {
+            return !watch_ || (watch_->generation == generation_ &&
+                               watch_->words == words_ && watch_->size == size_);
+        }
+
+        [[nodiscard]] inline size_type size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] inline size_type ones() const noexcept
+        {
+            return ones_;
+        }
+
+        // index size in bytes
+        [[nodiscard]] inline size_type overhead() const noexcept
+        {
+            return super_.size() * sizeof(uint64_t) + blocks_.size() * sizeof(uint16_t) +
+                   samples_.size() * sizeof(uint32_t);
+        }
+
+        // ones in [0, pos), pos <= size()
+        [[nodiscard]] inline size_type rank(size_type pos) const noexcept(!checked_)
+        {
+            check_fresh_("rank_select::rank: bits changed since rebuild()");
+            auto block = pos / block_bits;
+            auto result = rank_of_block_(block);
+
+            auto word = pos / jules::bits::word_bits;
+            for (auto i = block * block_words_; i != word; i++)
+                result += jules::bits::popcount(words_[i]);
+
+            if (pos % jules::bits::word_bits != 0)
+                result += jules::bits::popcount(words_[word] & jules::bits::tail_mask(pos));
+
+            return result;
+        }
+
+        // zeros in [0, pos), pos <= size()
+        [[nodiscard]] inline size_type rank0(size_type pos) const noexcept(!checked_)
+        {
+            return pos - rank(pos);
+        }
+
+        [[nodiscard]] inline size_type select(size_type k) const noexcept(!checked_)
+        {
+            check_fresh_("rank_select::select: bits changed since rebuild()");
+            if (k >= ones_)
+                return size_;
+
+            // last block starting with at most k ones before it
+            auto sample = k / select_sample;
+            size_type low = samples_.at_unchecked(sample);
+            size_type high = (sample + 1 < samples_.size()) ? samples_.at_unchecked(sample + 1) :
+                                                              blocks_.size() - 1;
+            while (low < high)
+            {
+                auto middle = (low + high + 1) / 2;
+                if (rank_of_block_(middle) <= k)
+                    low = middle;
+                else
+                    high = middle - 1;
+            }
+
+            k -= rank_of_block_(low);
+            for (auto i = low * block_words_;; i++)
+            {
+                auto ones = jules::bits::popcount(words_[i]);
+                if (k < ones)
+                    return i * jules::bits::word_bits + jules::bits::select_in_word(words_[i], k);
+
+                k -= ones;
+            }
+        }
+    };
+}
@@ -0,0 +1,1210 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    roaring.hpp
+
+Abstract:
+
+    Compressed bitmap for sparse bit sets over a 2^32 universe, the
+    memory-efficient alternative to vector<bool>. Bits are split into
+    chunks of 2^16 by their high 16 bits, empty chunks are not stored and
+    every other one keeps the cheapest of:
+
+        array  - sorted low 16 bits, up to 4096 of them (2 bytes a bit)
+        bitmap - 1024 words (8 KB)
+        run    - [start, start + length] pairs (4 bytes a run)
+
+    Access mirrors vector<bool>: size(), operator[], count(), find_first(),
+    find_next(), for_each_set_bit(), &, |, conversion to and from
+    vector<bool>. Bitmap chunks are combined and counted with the AVX2
+    kernels from bits.hpp, arrays are merged (galloping when one is much
+    smaller), 8 lows at a time with SSE4.2 compares and min / max networks
+    when built with AVX2, arrays against bitmaps by a branchless filter.
+    &= and |= work on the chunks in place. Updates turn run chunks back
+    into arrays or bitmaps, optimize() picks runs again where they are
+    smaller.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "bits.hpp"
+#include "vector.hpp"
+
+//
+// Defines
+//
+
+namespace jules
+{
+    class roaring_bitmap
+    {
+    public:
+        using size_type            = std::size_t;
+        using word_type            = jules::bits::word_type;
+
+        static constexpr size_type chunk_bits
+                                   = size_type(1) << 16;
+        static constexpr size_type chunk_words
+                                   = chunk_bits / jules::bits::word_bits;
+        static constexpr size_type array_max
+                                   = 4096;
+        static constexpr size_type max_bits
+                                   = size_type(1) << 32;
+
+        enum class kind : uint8_t
+        {
+            array,
+            bitmap,
+            run,
+        };
+
+    protected:
+        struct chunk
+        {
+            uint16_t key = 0;                   // high 16 bits
+            kind type = kind::array;
+            uint32_t cardinality = 0;
+            jules::vector<uint16_t> values;     // sorted lows, or start, length - 1 pairs
+            jules::vector<word_type> words;     // chunk_words for bitmaps
+        };
+
+        jules::vector<chunk> chunks_;           // sorted by key, none empty
+        size_type size_ = 0;
+
+        //
+        // Chunk level
+        //
+
+        [[nodiscard]] static inline size_type runs_number_(chunk const& c) noexcept
+        {
+            return c.values.size() / 2;
+        }
+
+        [[nodiscard]] static inline uint16_t const* lower_bound_(jules::vector<uint16_t> const& values, uint32_t low) noexcept
+        {
+            return std::lower_bound(values.data(), values.data() + values.size(), low);
+        }
+
+        // first run ending at low or after it
+        [[nodiscard]] static inline size_type run_at_(chunk const& c, uint32_t low) noexcept
+        {
+            size_type first = 0, last = runs_number_(c);
+            while (first < last)
+            {
+                auto middle = (first + last) / 2;
+                auto end = uint32_t(c.values.at_unchecked(2 * middle)) + c.values.at_unchecked(2 * middle + 1);
+                if (end < low)
+                    first = middle + 1;
+                else
+                    last = middle;
+            }
+
+            return first;
+        }
+
+        [[nodiscard]] static inline bool contains_(chunk const& c, uint32_t low) noexcept
+        {
+            switch (c.type)
+            {
+            case kind::array:
+            {
+                auto it = lower_bound_(c.values, low);
+                return it != c.values.data() + c.values.size() && *it == low;
+            }
+
+            case kind::bitmap:
+                return (c.words.at_unchecked(low / 64) >> (low % 64)) & 1;
+
+            default:
+            {
+                auto run = run_at_(c, low);
+                return run != runs_number_(c) && c.values.at_unchecked(2 * run) <= low;
+            }
+            }
+        }
+
+        // first set low >= from, chunk_bits if none
+        [[nodiscard]] static inline uint32_t find_next_(chunk const& c, uint32_t from) noexcept
+        {
+            switch (c.type)
+            {
+            case kind::array:
+            {
+                auto it = lower_bound_(c.values, from);
+                return it != c.values.data() + c.values.size() ? *it : chunk_bits;
+            }
+
+            case kind::bitmap:
+                return static_cast<uint32_t>(jules::bits::find_next(c.words.data(), chunk_bits, from));
+
+            default:
+            {
+                auto run = run_at_(c, from);
+                if (run == runs_number_(c))
+                    return chunk_bits;
+
+                return std::max<uint32_t>(c.values.at_unchecked(2 * run), from);
+            }
+            }
+        }
+
+        template<typename Fn>
+        static inline void for_each_(chunk const& c, Fn& fn)
+        {
+            size_type base = size_type(c.key) << 16;
+            switch (c.type)
+            {
+            case kind::array:
+                for (size_type i = 0; i != c.values.size(); i++)
+                    fn(base + c.values.at_unchecked(i));
+                break;
+
+            case kind::bitmap:
+                jules::bits::for_each_set(c.words.data(), chunk_bits, [&](size_type low) { fn(base + low); });
+                break;
+
+            default:
+                for (size_type run = 0; run != runs_number_(c); run++)
+                {
+                    size_type start = c.values.at_unchecked(2 * run);
+                    for (size_type low = start; low <= start + c.values.at_unchecked(2 * run + 1); low++)
+                        fn(base + low);
+                }
+                break;
+            }
+        }
+
+        // ors the chunk into chunk_words words
+        static inline void write_words_(chunk const& c, word_type* words) noexcept
+        {
+            switch (c.type)
+            {
+            case kind::array:
+                for (size_type i = 0; i != c.values.size(); i++)
+                {
+                    auto low = c.values.at_unchecked(i);
+                    words[low / 64] |= word_type(1) << (low % 64);
+                }
+                break;
+
+            case kind::bitmap:
+                for (size_type i = 0; i != chunk_words; i++)
+                    words[i] |= c.words.at_unchecked(i);
+                break;
+
+            default:
+                for (size_type run = 0; run != runs_number_(c); run++)
+                {
+                    size_type start = c.values.at_unchecked(2 * run);
+                    jules::bits::fill_range(words, start, start + c.values.at_unchecked(2 * run + 1) + 1, true);
+                }
+                break;
+            }
+        }
+
+        static inline void to_bitmap_(chunk& c)
+        {
+            if (c.type == kind::bitmap)
+                return;
+
+            c.words.clear();
+            c.words.resize(chunk_words);
+            write_words_(c, c.words.data());
+            c.values.clear();
+            c.values.shrink_to_fit();
+            c.type = kind::bitmap;
+        }
+
+        static inline void to_array_(chunk& c)
+        {
+            if (c.type == kind::array)
+                return;
+
+            jules::vector<uint16_t> values;
+            values.reserve(c.cardinality);
+            auto push = [&](size_type position) { values.push_back(static_cast<uint16_t>(position)); };
+            for_each_(c, push);
+
+            c.values = std::move(values);
+            c.words.clear();
+            c.words.shrink_to_fit();
+            c.type = kind::array;
+        }
+
+        // array or bitmap, whichever the cardinality asks for
+        static inline void normalize_(chunk& c)
+        {
+            if (c.cardinality <= array_max)
+                to_array_(c);
+            else
+                to_bitmap_(c);
+        }
+
+        [[nodiscard]] static inline size_type bitmap_runs_(word_type const* words) noexcept
+        {
+            size_type runs = 0;
+            word_type carry = 0;
+            for (size_type i = 0; i != chunk_words; i++)
+            {
+                // ones with a zero below them start a run
+                runs += jules::bits::popcount(words[i] & ~((words[i] << 1) | carry));
+                carry = words[i] >> 63;
+            }
+
+            return runs;
+        }
+
+        // chunk words -> runs
+        static inline void words_to_runs_(chunk& c, word_type const* words)
+        {
+            c.values.clear();
+            size_type low = jules::bits::find_first(words, chunk_bits);
+            while (low != chunk_bits)
+            {
+                auto end = jules::bits::find_next_clear(words, chunk_bits, low);
+                c.values.push_back(static_cast<uint16_t>(low));
+                c.values.push_back(static_cast<uint16_t>(end - low - 1));
+                low = jules::bits::find_next(words, chunk_bits, end);
+            }
+
+            c.words.clear();
+            c.words.shrink_to_fit();
+            c.type = kind::run;
+        }
+
+        // smallest encoding of a chunk given by its words
+        [[nodiscard]] static inline chunk from_words_(uint16_t key, word_type const* words, size_type cardinality)
+        {
+            chunk c;
+            c.key = key;
+            c.cardinality = static_cast<uint32_t>(cardinality);
+
+            auto runs = bitmap_runs_(words);
+            auto array_bytes = cardinality <= array_max ? 2 * cardinality : chunk_bits;
+            if (4 * runs < std::min(array_bytes, chunk_words * sizeof(word_type)))
+            {
+                words_to_runs_(c, words);
+                return c;
+            }
+
+            c.type = kind::bitmap;
+            c.words.resize(chunk_words);
+            std::memcpy(c.words.data(), words, chunk_words * sizeof(word_type));
+            normalize_(c);
+            return c;
+        }
+
+        //
+        // Chunk list
+        //
+
+        // index of the first chunk with key >= key
+        [[nodiscard]] inline size_type chunk_index_(uint32_t key) const noexcept
+        {
+            size_type first = 0, last = chunks_.size();
+            while (first < last)
+            {
+                auto middle = (first + last) / 2;
+                if (chunks_.at_unchecked(middle).key < key)
+                    first = middle + 1;
+                else
+                    last = middle;
+            }
+
+            return first;
+        }
+
+        [[nodiscard]] inline chunk const* find_chunk_(uint32_t key) const noexcept
+        {
+            auto index = chunk_index_(key);
+            if (index != chunks_.size() && chunks_.at_unchecked(index).key == key)
+                return &chunks_.at_unchecked(index);
+
+            return nullptr;
+        }
+
+        inline void check_index_(size_type index, char const* fnc) const
+        {
+            if (index >= size_)
+                std::__throw_out_of_range_fmt("%s: "
+                    "index == %zu out of range within size == %zu",
+                    fnc, index, size_);
+        }
+
+        inline void check_size_(size_type size, char const* fnc) const
+        {
+            if (size > max_bits)
+                std::__throw_out_of_range_fmt("%s: "
+                    "size == %zu exceeds 2^32",
+                    fnc, size);
+        }
+
+        inline void add_(uint32_t position)
+        {
+            uint16_t key = position >> 16, low = position & 0xFFFF;
+            auto index = chunk_index_(key);
+            if (index == chunks_.size() || chunks_.at_unchecked(index).key != key)
+            {
+                chunk c;
+                c.key = key;
+                c.cardinality = 1;
+                c.values.push_back(low);
+                chunks_.insert(chunks_.begin() + index, std::move(c));
+                return;
+            }
+
+            auto& c = chunks_.at_unchecked(index);
+            if (contains_(c, low))
+                return;
+
+            if (c.type == kind::run)
+                normalize_(c);
+
+            c.cardinality++;
+            if (c.type == kind::bitmap)
+            {
+                c.words.at_unchecked(low / 64) |= word_type(1) << (low % 64);
+                return;
+            }
+
+            auto at = lower_bound_(c.values, low) - c.values.data();
+            c.values.insert(c.values.begin() + at, low);
+            if (c.cardinality > array_max)
+                to_bitmap_(c);
+        }
+
+        inline void remove_(uint32_t position)
+        {
+            uint16_t key = position >> 16, low = position & 0xFFFF;
+            auto index = chunk_index_(key);
+            if (index == chunks_.size() || chunks_.at_unchecked(index).key != key)
+                return;
+
+            auto& c = chunks_.at_unchecked(index);
+            if (!contains_(c, low))
+                return;
+
+            if (--c.cardinality == 0)
+            {
+                chunks_.erase(chunks_.begin() + index);
+                return;
+            }
+
+            if (c.type == kind::run)
+                normalize_(c);
+
+            if (c.type == kind::bitmap)
+            {
+                c.words.at_unchecked(low / 64) &= ~(word_type(1) << (low % 64));
+                normalize_(c);
+                return;
+            }
+
+            auto at = lower_bound_(c.values, low) - c.values.data();
+            c.values.erase(c.values.begin() + at);
+        }
+
+        //
+        // Binary operations on chunks, both already array or bitmap
+        //
+
+        // arrays this many times longer than the other are galloped through
+        static constexpr size_type gallop_ratio_
+                                   = 64;
+
+#ifdef __AVX2__
+        // sorted lanes of a and b, low gets the 8 smallest and high the
+        // rest, both sorted (a merging network of min / max and rotations)
+        static inline void merge_lanes_(__m128i a, __m128i b, __m128i& low, __m128i& high) noexcept
+        {
+            auto min = _mm_min_epu16(a, b);
+            high = _mm_max_epu16(a, b);
+            for (int i = 0; i != 7; i++)
+            {
+                min = _mm_alignr_epi8(min, min, 2);
+                auto next = _mm_min_epu16(min, high);
+                high = _mm_max_epu16(min, high);
+                min = next;
+            }
+
+            low = _mm_alignr_epi8(min, min, 2);
+        }
+
+        // lanes of v differing from the lane before them (last of previous
+        // for the first one), returns how many were written
+        [[nodiscard]] static inline size_type store_unique_(__m128i previous, __m128i v, uint16_t* out) noexcept
+        {
+            auto before = _mm_alignr_epi8(v, previous, 14);
+            auto mask = ~static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(v, before))) & 0x5555u;
+
+            alignas(16) uint16_t lanes[8];
+            _mm_store_si128(reinterpret_cast<__m128i*>(lanes), v);
+
+            size_type n = 0;
+            for (; mask != 0; mask &= mask - 1)
+                out[n++] = lanes[__builtin_ctz(mask) / 2];
+
+            return n;
+        }
+#endif
+
+        // lows of small in large, galloping through large, out may be either
+        [[nodiscard]] static inline size_type gallop_(uint16_t const* small, size_type small_size,
+                                                      uint16_t const* large, size_type large_size,
+                                                      uint16_t* out) noexcept
+        {
+            size_type n = 0;
+            auto it = large;
+            auto end = large + large_size;
+            for (size_type i = 0; i != small_size && it != end; i++)
+            {
+                auto low = small[i];
+                size_type step = 1;
+                while (it + step < end && it[step] < low)
+                    step *= 2;
+
+                it = std::lower_bound(it, std::min(it + step + 1, end), low);
+                if (it != end && *it == low)
+                    out[n++] = low;
+            }
+
+            return n;
+        }
+
+        // lows in both, out may be a; returns how many
+        [[nodiscard]] static inline size_type intersect_(uint16_t const* a, size_type a_size,
+                                                         uint16_t const* b, size_type b_size,
+                                                         uint16_t* out) noexcept
+        {
+            if (a_size * gallop_ratio_ < b_size)
+                return gallop_(a, a_size, b, b_size, out);
+            if (b_size * gallop_ratio_ < a_size)
+                return gallop_(b, b_size, a, a_size, out);
+
+            size_type i = 0, j = 0, n = 0;
+#ifdef __AVX2__
+            // 8 lows against 8 at once, the block with the smaller last low
+            // moves on; a`s block is kept in lanes as out may overwrite it
+            if (a_size >= 8 && b_size >= 8)
+            {
+                alignas(16) uint16_t lanes[8];
+                auto va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a));
+                auto vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b));
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes), va);
+
+                while (true)
+                {
+                    auto mask = static_cast<unsigned>(_mm_cvtsi128_si32(_mm_cmpestrm(vb, 8, va, 8,
+                        _SIDD_UWORD_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK)));
+                    for (; mask != 0; mask &= mask - 1)
+                        out[n++] = lanes[__builtin_ctz(mask)];
+
+                    auto a_last = lanes[7], b_last = b[j + 7];
+                    if (a_last <= b_last)
+                    {
+                        i += 8;
+                        if (i + 8 > a_size)
+                            break;
+
+                        va = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+                        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), va);
+                    }
+
+                    if (b_last <= a_last)
+                    {
+                        j += 8;
+                        if (j + 8 > b_size)
+                            break;
+
+                        vb = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + j));
+                    }
+                }
+            }
+#endif
+
+            while (i != a_size && j != b_size)
+            {
+                if (a[i] < b[j])
+                    i++;
+                else if (b[j] < a[i])
+                    j++;
+                else
+                {
+                    out[n++] = a[i];
+                    i++;
+                    j++;
+                }
+            }
+
+            return n;
+        }
+
+        // lows in either, out holds a_size + b_size and is neither; returns how many
+        [[nodiscard]] static inline size_type unite_(uint16_t const* a, size_type a_size,
+                                                     uint16_t const* b, size_type b_size,
+                                                     uint16_t* out) noexcept
+        {
+            size_type i = 0, j = 0, n = 0;
+            uint16_t rest[8];
+            size_type rest_size = 0, k = 0;
+#ifdef __AVX2__
+            // merges 8 lows at a time from the block with the smaller first
+            // one, high keeps the 8 not yet known to be the smallest
+            if (a_size >= 8 && b_size >= 8)
+            {
+                __m128i low, high;
+                merge_lanes_(_mm_loadu_si128(reinterpret_cast<__m128i const*>(a)),
+                             _mm_loadu_si128(reinterpret_cast<__m128i const*>(b)), low, high);
+                i = j = 8;
+
+                // no first lane is 0xFFFF: it is the least of 8 distinct lows
+                n += store_unique_(_mm_set1_epi16(-1), low, out);
+                auto previous = low;
+                while (i + 8 <= a_size && j + 8 <= b_size)
+                {
+                    __m128i v;
+                    if (a[i] <= b[j])
+                    {
+                        v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(a + i));
+                        i += 8;
+                    }
+
+                    else
+                    {
+                        v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(b + j));
+                        j += 8;
+                    }
+
+                    merge_lanes_(v, high, low, high);
+                    n += store_unique_(previous, low, out + n);
+                    previous = low;
+                }
+
+                rest_size = store_unique_(previous, high, rest);
+            }
+#endif
+
+            // what is left of a, b and high
+            while (k != rest_size || i != a_size || j != b_size)
+            {
+                uint32_t low = chunk_bits;
+                if (k != rest_size)
+                    low = std::min<uint32_t>(low, rest[k]);
+                if (i != a_size)
+                    low = std::min<uint32_t>(low, a[i]);
+                if (j != b_size)
+                    low = std::min<uint32_t>(low, b[j]);
+
+                k += k != rest_size && rest[k] == low;
+                i += i != a_size && a[i] == low;
+                j += j != b_size && b[j] == low;
+                if (n == 0 || out[n - 1] != low)
+                    out[n++] = static_cast<uint16_t>(low);
+            }
+
+            return n;
+        }
+
+        // lows of an array set in words, out may be values; returns how many
+        [[nodiscard]] static inline size_type filter_(uint16_t const* values, size_type size,
+                                                      word_type const* words, uint16_t* out) noexcept
+        {
+            size_type n = 0;
+            for (size_type i = 0; i != size; i++)
+            {
+                auto low = values[i];
+                out[n] = low;
+                n += (words[low / 64] >> (low % 64)) & 1;
+            }
+
+            return n;
+        }
+
+        // a &= b, in a`s own storage where the kinds allow
+        static inline void and_(chunk& a, chunk const& b)
+        {
+            if (a.type == kind::bitmap && b.type == kind::bitmap)
+            {
+                jules::bits::combine<jules::bits::op_and>(a.words.data(), b.words.data(), chunk_words, chunk_words);
+                a.cardinality = static_cast<uint32_t>(jules::bits::count(a.words.data(), chunk_bits));
+                normalize_(a);
+                return;
+            }
+
+            size_type n = 0;
+            if (a.type == kind::bitmap)
+            {
+                a.values = b.values;
+                n = filter_(a.values.data(), a.values.size(), a.words.data(), a.values.data());
+                a.words.clear();
+                a.words.shrink_to_fit();
+                a.type = kind::array;
+            }
+
+            else if (b.type == kind::bitmap)
+                n = filter_(a.values.data(), a.values.size(), b.words.data(), a.values.data());
+            else
+                n = intersect_(a.values.data(), a.values.size(), b.values.data(), b.values.size(), a.values.data());
+
+            a.values.resize(n);
+            a.cardinality = static_cast<uint32_t>(n);
+        }
+
+        // a |= b, in a`s own storage unless two arrays are merged
+        static inline void or_(chunk& a, chunk const& b)
+        {
+            if (a.type == kind::array && b.type == kind::array && a.cardinality + b.cardinality <= array_max)
+            {
+                jules::vector<uint16_t> values;
+                values.resize_for_overwrite(a.values.size() + b.values.size());
+                values.resize(unite_(a.values.data(), a.values.size(), b.values.data(), b.values.size(),
+                                     values.data()));
+
+                a.values = std::move(values);
+                a.cardinality = static_cast<uint32_t>(a.values.size());
+                return;
+            }
+
+            if (a.type == kind::array && b.type == kind::bitmap)
+            {
+                a.words = b.words;
+                write_words_(a, a.words.data());
+                a.values.clear();
+                a.values.shrink_to_fit();
+                a.type = kind::bitmap;
+            }
+
+            else
+            {
+                to_bitmap_(a);
+                if (b.type == kind::bitmap)
+                    jules::bits::combine<jules::bits::op_or>(a.words.data(), b.words.data(), chunk_words, chunk_words);
+                else
+                    write_words_(b, a.words.data());
+            }
+
+            a.cardinality = static_cast<uint32_t>(jules::bits::count(a.words.data(), chunk_bits));
+            normalize_(a);
+        }
+
+        // runs are turned into arrays / bitmaps for the merge
+        [[nodiscard]] static inline chunk const& plain_(chunk const& c, chunk& buffer)
+        {
+            if (c.type != kind::run)
+                return c;
+
+            buffer = c;
+            normalize_(buffer);
+            return buffer;
+        }
+
+    public:
+        //
+        // Constructors
+        //
+
+        explicit roaring_bitmap(size_type size = 0)
+        {
+            check_size_(size, "roaring_bitmap::roaring_bitmap(size_type)");
+            size_ = size;
+        }
+
+        // from vector<bool> / array<bool>, or anything with word_data() and size()
+        template<class Bits, typename = decltype(std::declval<Bits const&>().word_data())>
+        explicit roaring_bitmap(Bits const& bits)
+        {
+            check_size_(bits.size(), "roaring_bitmap::roaring_bitmap(Bits const&)");
+            size_ = bits.size();
+
+            // last chunk may be short, it is padded with zeros
+            word_type padded[chunk_words];
+            auto words = bits.word_data();
+            auto total = jules::bits::words_number(size_);
+            for (size_type first = 0; first < total; first += chunk_words)
+            {
+                auto n = std::min(chunk_words, total - first);
+                auto cardinality = jules::bits::count(words + first, n * jules::bits::word_bits);
+                if (cardinality == 0)
+                    continue;
+
+                auto source = words + first;
+                if (n != chunk_words)
+                {
+                    std::memset(padded, 0, sizeof(padded));
+                    std::memcpy(padded, source, n * sizeof(word_type));
+                    source = padded;
+                }
+
+                chunks_.push_back(from_words_(static_cast<uint16_t>(first / chunk_words), source, cardinality));
+            }
+        }
+
+        [[nodiscard]] inline jules::vector<bool> to_vector() const
+        {
+            jules::vector<bool> result(size_);
+            auto words = result.word_data();
+            auto total = jules::bits::words_number(size_);
+            word_type padded[chunk_words];
+
+            for (size_type i = 0; i != chunks_.size(); i++)
+            {
+                auto const& c = chunks_.at_unchecked(i);
+                auto first = size_type(c.key) * chunk_words;
+                if (first + chunk_words <= total)
+                {
+                    write_words_(c, words + first);
+                    continue;
+                }
+
+                std::memset(padded, 0, sizeof(padded));
+                write_words_(c, padded);
+                std::memcpy(words + first, padded, (total - first) * sizeof(word_type));
+            }
+
+            return result;
+        }
+
+        //
+        // Element access
+        //
+
+        class reference
+        {
+            friend class roaring_bitmap;
+
+            roaring_bitmap& owner_;
+            uint32_t position_;
+
+            reference(roaring_bitmap& owner, uint32_t position) noexcept :
+                owner_(owner),
+                position_(position)
+            {
+            }
+
+        public:
+            reference(reference const&) = default; // not explicit
+
+            reference& operator=(bool value)
+            {
+                owner_.set(position_, value);
+                return *this;
+            }
+
+            reference& operator=(reference const& other)
+            {
+                return *this = bool(other);
+            }
+
+            operator bool() const noexcept
+            {
+                return owner_.test(position_);
+            }
+        };
+
+        [[nodiscard]] inline bool test(size_type index) const noexcept
+        {
+            auto c = find_chunk_(static_cast<uint32_t>(index >> 16));
+            return c != nullptr && contains_(*c, index & 0xFFFF);
+        }
+
+        [[nodiscard]] inline bool operator[](size_type index) const
+        {
+            check_index_(index, "roaring_bitmap::operator[](size_type)");
+            return test(index);
+        }
+
+        [[nodiscard]] inline reference operator[](size_type index)
+        {
+            check_index_(index, "roaring_bitmap::operator[](size_type)");
+            return reference(*this, static_cast<uint32_t>(index));
+        }
+
+        inline void set(size_type index, bool value = true)
+        {
+            check_index_(index, "roaring_bitmap::set(size_type, bool)");
+            if (value)
+                add_(static_cast<uint32_t>(index));
+            else
+                remove_(static_cast<uint32_t>(index));
+        }
+
+        inline void reset(size_type index)
+        {
+            set(index, false);
+        }
+
+        //
+        // Capacity
+        //
+
+        [[nodiscard]] inline bool empty() const noexcept
+        {
+            return size_ == 0;
+        }
+
+        [[nodiscard]] inline size_type size() const noexcept
+        {
+            return size_;
+        }
+
+        [[nodiscard]] inline size_type max_size() const noexcept
+        {
+            return max_bits;
+        }
+
+        // bytes held by chunks
+        [[nodiscard]] inline size_type memory() const noexcept
+        {
+            size_type result = chunks_.capacity() * sizeof(chunk);
+            for (size_type i = 0; i != chunks_.size(); i++)
+            {
+                auto const& c = chunks_.at_unchecked(i);
+                result += c.values.capacity() * sizeof(uint16_t) + c.words.capacity() * sizeof(word_type);
+            }
+
+            return result;
+        }
+
+        [[nodiscard]] inline size_type chunks() const noexcept
+        {
+            return chunks_.size();
+        }
+
+        [[nodiscard]] inline kind chunk_kind(size_type index) const
+        {
+            return chunks_[index].type;
+        }
+
+        //
+        // Modifiers
+        //
+
+        inline void clear() noexcept
+        {
+            chunks_.clear();
+            size_ = 0;
+        }
+
+        // bits past new_size are dropped, new bits are zero
+        inline void resize(size_type new_size)
+        {
+            check_size_(new_size, "roaring_bitmap::resize(size_type)");
+            if (new_size >= size_)
+            {
+                size_ = new_size;
+                return;
+            }
+
+            auto keep = chunk_index_(static_cast<uint32_t>(new_size >> 16));
+            while (chunks_.size() > keep + 1)
+                chunks_.pop_back();
+
+            if (chunks_.size() == keep + 1 && chunks_.at_unchecked(keep).key == (new_size >> 16))
+            {
+                auto& c = chunks_.at_unchecked(keep);
+                to_bitmap_(c);
+                jules::bits::fill_range(c.words.data(), new_size & 0xFFFF, chunk_bits, false);
+                c.cardinality = static_cast<uint32_t>(jules::bits::count(c.words.data(), chunk_bits));
+                if (c.cardinality == 0)
+                    chunks_.pop_back();
+                else
+                    normalize_(c);
+            }
+
+            else if (chunks_.size() == keep + 1)
+                chunks_.pop_back();
+
+            size_ = new_size;
+        }
+
+        inline void push_back(bool value)
+        {
+            resize(size_ + 1);
+            if (value)
+                add_(static_cast<uint32_t>(size_ - 1));
+        }
+
+        // run encoding for chunks where it is smaller
+        inline void optimize()
+        {
+            word_type words[chunk_words];
+            for (size_type i = 0; i != chunks_.size(); i++)
+            {
+                auto& c = chunks_.at_unchecked(i);
+                if (c.type == kind::run)
+                    continue;
+
+                std::memset(words, 0, sizeof(words));
+                write_words_(c, words);
+                c = from_words_(c.key, words, c.cardinality);
+            }
+        }
+
+        //
+        // Bit queries, searches return size() when nothing is found
+        //
+
+        [[nodiscard]] inline size_type count() const noexcept
+        {
+            size_type result = 0;
+            for (size_type i = 0; i != chunks_.size(); i++)
+                result += chunks_.at_unchecked(i).cardinality;
+
+            return result;
+        }
+
+        [[nodiscard]] inline bool any() const noexcept
+        {
+            return !chunks_.empty();
+        }
+
+        [[nodiscard]] inline bool none() const noexcept
+        {
+            return chunks_.empty();
+        }
+
+        [[nodiscard]] inline size_type find_first() const noexcept
+        {
+            return find_next(0);
+        }
+
+        // first set bit at pos or after it
+        [[nodiscard]] inline size_type find_next(size_type pos) const noexcept
+        {
+            if (pos >= size_)
+                return size_;
+
+            for (auto i = chunk_index_(static_cast<uint32_t>(pos >> 16)); i < chunks_.size(); i++)
+            {
+                auto const& c = chunks_.at_unchecked(i);
+                auto base = size_type(c.key) << 16;
+                auto low = find_next_(c, base < pos ? static_cast<uint32_t>(pos - base) : 0);
+                if (low != chunk_bits)
+                    return base + low;
+            }
+
+            return size_;
+        }
+
+        template<typename Fn>
+        inline void for_each_set_bit(Fn&& fn) const
+        {
+            for (size_type i = 0; i != chunks_.size(); i++)
+                for_each_(chunks_.at_unchecked(i), fn);
+        }
+
+        //
+        // Bitwise, the shorter operand is zero-extended and the result
+        // has the longer size, as for vector<bool>
+        //
+
+        [[nodiscard]] friend inline roaring_bitmap operator&(roaring_bitmap const& lhs, roaring_bitmap const& rhs)
+        {
+            roaring_bitmap result(std::max(lhs.size_, rhs.size_));
+            chunk left, right;
+
+            size_type i = 0, j = 0;
+            while (i != lhs.chunks_.size() && j != rhs.chunks_.size())
+            {
+                auto const& a = lhs.chunks_.at_unchecked(i);
+                auto const& b = rhs.chunks_.at_unchecked(j);
+                if (a.key < b.key)
+                    i++;
+                else if (b.key < a.key)
+                    j++;
+                else
+                {
+                    // starts from the array, if any
+                    auto const& x = plain_(a, left);
+                    auto const& y = plain_(b, right);
+                    auto swap = x.type == kind::bitmap && y.type == kind::array;
+
+                    chunk c = swap ? y : x;
+                    and_(c, swap ? x : y);
+                    if (c.cardinality != 0)
+                        result.chunks_.push_back(std::move(c));
+                    i++;
+                    j++;
+                }
+            }
+
+            return result;
+        }
+
+        [[nodiscard]] friend inline roaring_bitmap operator|(roaring_bitmap const& lhs, roaring_bitmap const& rhs)
+        {
+            roaring_bitmap result(std::max(lhs.size_, rhs.size_));
+            chunk left, right;
+
+            size_type i = 0, j = 0;
+            while (i != lhs.chunks_.size() || j != rhs.chunks_.size())
+            {
+                if (j == rhs.chunks_.size() || (i != lhs.chunks_.size() &&
+                                                lhs.chunks_.at_unchecked(i).key < rhs.chunks_.at_unchecked(j).key))
+                    result.chunks_.push_back(lhs.chunks_.at_unchecked(i++));
+                else if (i == lhs.chunks_.size() ||
+                         rhs.chunks_.at_unchecked(j).key < lhs.chunks_.at_unchecked(i).key)
+                    result.chunks_.push_back(rhs.chunks_.at_unchecked(j++));
+                else
+                {
+                    // starts from the bitmap, if any
+                    auto const& x = plain_(lhs.chunks_.at_unchecked(i++), left);
+                    auto const& y = plain_(rhs.chunks_.at_unchecked(j++), right);
+                    auto swap = y.type == kind::bitmap && x.type != kind::bitmap;
+
+                    chunk c = swap ? y : x;
+                    or_(c, swap ? x : y);
+                    result.chunks_.push_back(std::move(c));
+                }
+            }
+
+            return result;
+        }
+
+        // chunk by chunk in place, chunks other lacks are dropped
+        inline roaring_bitmap& operator&=(roaring_bitmap const& other)
+        {
+            size_ = std::max(size_, other.size_);
+            if (&other == this)
+                return *this;
+
+            chunk right;
+            size_type kept = 0, j = 0;
+            for (size_type i = 0; i != chunks_.size(); i++)
+            {
+                auto& a = chunks_.at_unchecked(i);
+                while (j != other.chunks_.size() && other.chunks_.at_unchecked(j).key < a.key)
+                    j++;
+
+                if (j == other.chunks_.size() || other.chunks_.at_unchecked(j).key != a.key)
+                    continue;
+
+                if (a.type == kind::run)
+                    normalize_(a);
+
+                and_(a, plain_(other.chunks_.at_unchecked(j), right));
+                if (a.cardinality == 0)
+                    continue;
+
+                if (kept != i)
+                    chunks_.at_unchecked(kept) = std::move(a);
+                kept++;
+            }
+
+            while (chunks_.size() != kept)
+                chunks_.pop_back();
+
+            return *this;
+        }
+
+        // chunk by chunk in place, chunks only other has are copied in;
+        // the list grows by them first and is merged from its back
+        inline roaring_bitmap& operator|=(roaring_bitmap const& other)
+        {
+            size_ = std::max(size_, other.size_);
+            if (&other == this)
+                return *this;
+
+            size_type missing = 0, i = 0;
+            for (size_type j = 0; j != other.chunks_.size(); j++)
+            {
+                auto key = other.chunks_.at_unchecked(j).key;
+                while (i != chunks_.size() && chunks_.at_unchecked(i).key < key)
+                    i++;
+
+                missing += i == chunks_.size() || chunks_.at_unchecked(i).key != key;
+            }
+
+            chunk right;
+            i = chunks_.size();
+            chunks_.resize(i + missing);
+
+            auto j = other.chunks_.size(), w = chunks_.size();
+            while (j != 0)
+            {
+                auto const& b = other.chunks_.at_unchecked(j - 1);
+                if (i != 0 && chunks_.at_unchecked(i - 1).key > b.key)
+                    chunks_.at_unchecked(--w) = std::move(chunks_.at_unchecked(--i));
+
+                else if (i != 0 && chunks_.at_unchecked(i - 1).key == b.key)
+                {
+                    auto& a = chunks_.at_unchecked(--i);
+                    if (a.type == kind::run)
+                        normalize_(a);
+
+                    or_(a, plain_(b, right));
+                    if (--w != i)
+                        chunks_.at_unchecked(w) = std::move(a);
+                    j--;
+                }
+
+                else
+                {
+                    chunks_.at_unchecked(--w) = b;
+                    j--;
+                }
+            }
+
+            return *this;
+        }
+
+        //
+        // Comparison
+        //
+
+        // same bits, encodings may differ
+        [[nodiscard]] friend inline bool operator==(roaring_bitmap const& lhs, roaring_bitmap const& rhs)
+        {
+            if (lhs.size_ != rhs.size_ || lhs.chunks_.size() != rhs.chunks_.size())
+                return false;
+
+            word_type left[chunk_words], right[chunk_words];
+            for (size_type i = 0; i != lhs.chunks_.size(); i++)
+            {
+                auto const& a = lhs.chunks_.at_unchecked(i);
+                auto const& b = rhs.chunks_.at_unchecked(i);
+                if (a.key != b.key || a.cardinality != b.cardinality)
+                    return false;
+
+                std::memset(left, 0, sizeof(left));
+                std::memset(right, 0, sizeof(right));
+                write_words_(a, left);
+                write_words_(b, right);
+                if (std::memcmp(left, right, sizeof(left)) != 0)
+                    return false;
+            }
+
+            return true;
+        }
+
+        [[nodiscard]] friend inline bool operator!=(roaring_bitmap const& lhs, roaring_bitmap const& rhs)
+        {
+            return !(lhs == rhs);
+        }
+    };
+}
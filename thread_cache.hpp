@@ -0,0 +1,287 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    thread_cache.hpp
+
+Abstract:
+
+    Size class allocator with a cache per thread, for many threads that
+    grow and free containers at once:
+
+        jules::vector<int, jules::allocator::ThreadCache<int, true>> v;
+
+    Blocks of up to max_small bytes are rounded up to one of 40 size
+    classes (16 byte steps up to 128, then 4 classes per power of two).
+    Every thread keeps a free list per class and pops / pushes it without
+    any locking. An empty list is refilled with a batch of blocks from the
+    central pool of the class, a list grown past two batches gives one
+    batch back, so the central lock is taken once per batch, not once per
+    block. Central pools are the slab pools of allocators.hpp, a mutex
+    each. A thread returns its whole cache when it exits.
+
+    Blocks may be freed by another thread than the one that took them,
+    they just land in its cache. Bigger blocks come from malloc.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+
+#include "allocators.hpp"
+
+//
+// Defines
+//
+
+namespace jules::allocator
+{
+    class thread_cache
+    {
+    public:
+        static std::size_t constexpr classes
+                                   = 40;
+        static std::size_t constexpr max_small
+                                   = std::size_t(32) << 10;
+
+    protected:
+        struct block_
+        {
+            block_* next;
+        };
+
+        struct bin_
+        {
+            block_* head = nullptr;
+            std::size_t count = 0;
+        };
+
+        struct alignas(64) central_
+        {
+            std::mutex lock;
+            pool slabs;
+
+            explicit central_(std::size_t size) :
+                slabs(size)
+            {
+            }
+        };
+
+        bin_ bins_[classes];
+
+        template<std::size_t... Indices>
+        [[nodiscard]] static inline central_* make_central_(std::index_sequence<Indices...>)
+        {
+            static central_ table[] = { central_(class_size(Indices))... };
+            return table;
+        }
+
+        [[nodiscard]] static inline central_& central_of_(std::size_t index)
+        {
+            static central_* const table = make_central_(std::make_index_sequence<classes>());
+            return table[index];
+        }
+
+        [[nodiscard]] static inline thread_cache& local_()
+        {
+            static thread_local thread_cache cache;
+            return cache;
+        }
+
+        // ~32 KB per batch, at least 4 and at most 64 blocks
+        [[nodiscard]] static constexpr std::size_t batch_(std::size_t index) noexcept
+        {
+            auto blocks = (std::size_t(32) << 10) / class_size(index);
+            return blocks < 4 ? 4 : blocks > 64 ? 64 : blocks;
+        }
+
+        inline void refill_(std::size_t index)
+        {
+            auto& central = central_of_(index);
+            auto& bin = bins_[index];
+
+            std::lock_guard<std::mutex> guard(central.lock);
+            for (std::size_t i = 0; i != batch_(index); i++)
+            {
+                auto block = static_cast<block_*>(central.slabs.allocate());
+                block->next = bin.head;
+                bin.head = block;
+                bin.count++;
+            }
+        }
+
+        inline void drain_(std::size_t index, std::size_t blocks) noexcept
+        {
+            auto& central = central_of_(index);
+            auto& bin = bins_[index];
+
+            std::lock_guard<std::mutex> guard(central.lock);
+            for (; blocks != 0 && bin.head != nullptr; blocks--)
+            {
+                auto block = bin.head;
+                bin.head = block->next;
+                bin.count--;
+                central.slabs.deallocate(block);
+            }
+        }
+
+        inline void flush_() noexcept
+        {
+            for (std::size_t i = 0; i != classes; i++)
+                if (bins_[i].count != 0)
+                    drain_(i, bins_[i].count);
+        }
+
+        thread_cache() noexcept = default;
+
+    public:
+        thread_cache(thread_cache const&) = delete;
+        thread_cache& operator=(thread_cache const&) = delete;
+
+        ~thread_cache()
+        {
+            flush_();
+        }
+
+        // bytes is in [1, max_small]
+        [[nodiscard]] static constexpr std::size_t class_of(std::size_t bytes) noexcept
+        {
+            if (bytes <= 128)
+                return (bytes + 15) / 16 - 1;
+
+            std::size_t power = 7;
+            while ((bytes - 1) >> (power + 1))
+                power++;
+
+            return 8 + (power - 7) * 4 + ((bytes - 1) >> (power - 2)) - 4;
+        }
+
+        [[nodiscard]] static constexpr std::size_t class_size(std::size_t index) noexcept
+        {
+            if (index < 8)
+                return (index + 1) * 16;
+
+            auto power = 7 + (index - 8) / 4;
+            return (std::size_t(1) << power) + ((index - 8) % 4 + 1) * (std::size_t(1) << (power - 2));
+        }
+
+        // a block of class_size(index) bytes
+        [[nodiscard]] static inline void* allocate(std::size_t index)
+        {
+            auto& cache = local_();
+            auto& bin = cache.bins_[index];
+            if (bin.head == nullptr)
+                cache.refill_(index);
+
+            auto block = bin.head;
+            bin.head = block->next;
+            bin.count--;
+            return block;
+        }
+
+        static inline void deallocate(void* ptr, std::size_t index) noexcept
+        {
+            auto& cache = local_();
+            auto& bin = cache.bins_[index];
+            auto block = static_cast<block_*>(ptr);
+            block->next = bin.head;
+            bin.head = block;
+
+            if (++bin.count > 2 * batch_(index))
+                cache.drain_(index, batch_(index));
+        }
+
+        // blocks of a class sitting in this thread`s cache
+        [[nodiscard]] static inline std::size_t cached(std::size_t index) noexcept
+        {
+            return local_().bins_[index].count;
+        }
+
+        // gives this thread`s whole cache back to the central pools
+        static inline void flush() noexcept
+        {
+            local_().flush_();
+        }
+
+        [[nodiscard]] static inline pool::stats occupancy(std::size_t index)
+        {
+            auto& central = central_of_(index);
+            std::lock_guard<std::mutex> guard(central.lock);
+            return central.slabs.occupancy();
+        }
+    };
+
+    // small blocks from the thread cache, a whole size class each;
+    // bigger ones from malloc, as Default does
+    template<typename T, bool raw_memory = true>
+    class ThreadCache
+    {
+        static_assert(raw_memory, "ThreadCache: only raw memory!");
+
+    protected:
+        [[nodiscard]] static constexpr bool is_small_(std::size_t n) noexcept
+        {
+            return n <= thread_cache::max_small / sizeof(T);
+        }
+
+    public:
+        static bool const is_empty = false;
+        static bool const is_raw   = raw_memory;
+        using value_type           = T;
+        using size_type            = std::size_t;
+        using difference_type      = std::ptrdiff_t;
+
+        [[nodiscard]] inline value_type* allocate(size_type n)
+        {
+            return allocate_at_least(n).ptr;
+        }
+
+        [[nodiscard]] inline allocation_result<value_type> allocate_at_least(size_type n)
+        {
+            if (n == 0)
+                return { nullptr, 0 };
+
+            if (is_small_(n))
+            {
+                auto index = thread_cache::class_of(n * sizeof(T));
+                return { static_cast<value_type*>(thread_cache::allocate(index)),
+                         thread_cache::class_size(index) / sizeof(T) };
+            }
+
+            void* ptr = std::malloc(n * sizeof(T));
+            if (ptr == nullptr)
+                throw std::bad_alloc();
+
+            return { static_cast<value_type*>(ptr), usable_size(ptr, n * sizeof(T)) / sizeof(T) };
+        }
+
+        inline void deallocate(value_type* ptr, size_type n) noexcept
+        {
+            if (ptr == nullptr)
+                return;
+
+            if (is_small_(n))
+                thread_cache::deallocate(ptr, thread_cache::class_of(n * sizeof(T)));
+            else
+                std::free(ptr);
+        }
+    };
+}
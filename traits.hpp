@@ -0,0 +1,50 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    traits.hpp
+
+Abstract:
+
+    Type traits used by storages and containers.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#pragma once
+#include <type_traits>
+
+//
+// Defines
+//
+
+namespace jules
+{
+    //
+    // Type may be relocated (moved to another address and the source
+    // forgotten) with a plain memcpy. True for trivially copyable types,
+    // user types may opt in:
+    //
+    //     template<>
+    //     struct jules::is_trivially_relocatable<MyType> : std::true_type {};
+    //
+    template<typename T>
+    struct is_trivially_relocatable : std::is_trivially_copyable<T>
+    {
+    };
+
+    template<typename T>
+    inline constexpr bool is_trivially_relocatable_v = is_trivially_relocatable<T>::value;
+}
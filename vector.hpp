@@ -26,25 +26,43 @@ Revision History:
 
 #pragma once
 #include <cstddef>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <algorithm>
 #include <limits>
+#include <functional>
+#include <memory>
+#include <type_traits>
 #include "allocators.hpp"
 #include "on_stack.hpp"
 #include "on_heap.hpp"
+#include "hybrid.hpp"
+#include "growth.hpp"
+#include "bits.hpp"
 
 //
 // Defines
 //
 
+// #define JULES_CHECKED_ITERATORS // index + owner iterators, bounds checked on every access
 
 namespace jules
 {
+    // vector(size, default_init): elements are default-initialized, 
+    // trivial ones are left uninitialized
+    struct default_init_t
+    {
+        explicit default_init_t() = default;
+    };
+
+    inline constexpr default_init_t default_init{};
+
     // example: vector<int, 5, storage::on_stack>
     // template<typename T, size_t MaxSize/*, template<typename, size_t> class Storage*/>
     template<typename T, class Allocator = jules::allocator::Default<T, true>, 
-                         template<typename, size_t, class> class Storage = jules::storage::on_heap>
+                         template<typename, size_t, class> class Storage = jules::storage::on_heap,
+                         class Growth = jules::growth::doubling>
     class vector
     {
         static_assert(Allocator::is_raw, "Allocator for vector must be raw!");
@@ -56,6 +74,9 @@ namespace jules
         static size_type const initial_capacity
                                    = 0;
         using storage_type         = Storage<value_type, initial_capacity, allocator_type>;
+        using growth_policy        = Growth;
+        static size_type const alignment
+                                   = storage_type::alignment;
         using reference            = T&;
         using const_reference      = T const&;
         using pointer              = T*;
@@ -64,10 +85,10 @@ namespace jules
         class __vector_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
-            using pointer              = pointer;
-            using reference            = reference;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
+            using pointer              = typename vector::pointer;
+            using reference            = typename vector::reference;
             using iterator_category    = std::random_access_iterator_tag;
 
         protected:
@@ -193,8 +214,8 @@ namespace jules
         class __vector_const_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
             using pointer              = const_pointer;
             using reference            = const_reference;
             using iterator_category    = std::random_access_iterator_tag;
@@ -328,10 +349,10 @@ namespace jules
         class __vector_reverse_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
-            using pointer              = pointer;
-            using reference            = reference;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
+            using pointer              = typename vector::pointer;
+            using reference            = typename vector::reference;
             using iterator_category    = std::random_access_iterator_tag;
 
         protected:
@@ -462,8 +483,8 @@ namespace jules
         class __vector_reverse_const_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
             using pointer              = const_pointer;
             using reference            = const_reference;
             using iterator_category    = std::random_access_iterator_tag;
@@ -598,13 +619,26 @@ namespace jules
             }
         };
 
+#ifdef JULES_CHECKED_ITERATORS
         using iterator             = __vector_iterator;
         using const_iterator       = __vector_const_iterator;
         using reverse_iterator     = __vector_reverse_iterator;
         using const_reverse_iterator
                                    = __vector_reverse_const_iterator;
+#else
+        using iterator             = pointer;
+        using const_iterator       = const_pointer;
+        using reverse_iterator     = std::reverse_iterator<iterator>;
+        using const_reverse_iterator
+                                   = std::reverse_iterator<const_iterator>;
+#endif
 
     protected:
+        // on_heap steal is noexcept, hybrid may have to move inline elements
+        static bool const nothrow_movable_
+                                   = storage_type::is_stealable && 
+                                     std::is_nothrow_move_constructible<value_type>::value;
+
         storage_type storage_;
         size_type size_ = 0;
 
@@ -616,6 +650,7 @@ namespace jules
                     fnc, index, size_);
         }
 
+#ifdef JULES_CHECKED_ITERATORS
         template<typename It>
         inline void check_iterator_(It const& it, char const* fnc)
         {
@@ -628,39 +663,189 @@ namespace jules
                 check_index_(it.index_, fnc);
         }
 
+        [[nodiscard]] inline iterator iterator_at_(difference_type index) noexcept
+        {
+            return iterator(*this, index);
+        }
+
+        [[nodiscard]] inline const_iterator iterator_at_(difference_type index) const noexcept
+        {
+            return const_iterator(*this, index);
+        }
+
+        [[nodiscard]] inline difference_type index_of_(const_iterator const& it) const noexcept
+        {
+            return it.index_;
+        }
+#else
+        inline void check_iterator_(const_iterator it, char const* fnc) const
+        {
+            // still checked, but once per insert / erase, not per element
+            auto index = index_of_(it);
+            if (index < 0 || index > static_cast<difference_type>(size_))
+                std::__throw_out_of_range_fmt("%s: "
+                    "wrong iterator, it (%p) is not in [%p, %p]",
+                    fnc, it, data(), data() + size_);
+        }
+
+        [[nodiscard]] inline iterator iterator_at_(difference_type index) noexcept
+        {
+            return data() + index;
+        }
+
+        [[nodiscard]] inline const_iterator iterator_at_(difference_type index) const noexcept
+        {
+            return data() + index;
+        }
+
+        [[nodiscard]] inline difference_type index_of_(const_iterator it) const noexcept
+        {
+            return it - data();
+        }
+#endif
+
         inline bool is_created_(difference_type i)
         {
             return i < size_;
         }
 
-        inline void realloc_if_needed_(difference_type size_diff = 1)
+        // false if count more elements still don`t fit (fixed capacity
+        // storage with a dropping overflow policy), nothing is to be added then
+        [[nodiscard]] inline bool realloc_if_needed_(size_type count = 1)
         {    
             auto current_capacity = capacity();
-            auto new_size = size_ + size_diff;
-            if (size_diff < 0)
+            auto new_size = size_ + count;
+            assert(size_ <= current_capacity);
+
+            if (new_size <= current_capacity)
+                return true;
+
+            storage_.realloc(growth_policy::grow(current_capacity, new_size, sizeof(value_type)), size_);
+            return new_size <= capacity();
+        }
+
+        [[nodiscard]] inline bool reserve_(size_type new_capacity)
+        {
+            if (new_capacity > capacity())
+                storage_.realloc(new_capacity, size_);
+
+            return new_capacity <= capacity();
+        }
+
+        // reserves count and returns how many of them fit
+        [[nodiscard]] inline size_type reserve_at_most_(size_type count)
+        {
+            return reserve_(count) ? count : capacity();
+        }
+
+        // call after size_ went down
+        inline void shrink_if_needed_()
+        {
+            auto current_capacity = capacity();
+            auto new_capacity = growth_policy::shrink(current_capacity, size_, sizeof(value_type));
+            if (new_capacity < current_capacity)
+                storage_.realloc(new_capacity, size_);
+        }
+
+        inline void create_default_(difference_type start, size_t count)
+        {
+            for (difference_type i = 0; i != static_cast<difference_type>(count); i++)
+                storage_.create(i);
+        }
+
+        // creates [size_, new_size) default-initialized, capacity must be enough
+        inline void grow_for_overwrite_(size_type new_size)
+        {
+            assert(new_size <= capacity());
+            if constexpr (std::is_trivially_default_constructible<value_type>::value)
+            {
+                size_ = new_size;
+                return;
+            }
+
+            size_type i = size_;
+            try
             {
-                assert(-size_diff < size_);
+                for (; i != new_size; i++)
+                    storage_.create_for_overwrite(i);
+                
+                size_ = i;
             }
+            catch (...)
+            {
+                for (; i > size_;)
+                    storage_.destroy(--i);
 
-            assert(size_ <= current_capacity);
+                throw; // up
+            }
+        }
 
-            if (new_size * 4 <= current_capacity && current_capacity > 0)
+        // anything with data() and size() over value_type
+        template<typename Range, typename = void>
+        struct is_contiguous_range_ : std::false_type
+        {
+        };
+
+        template<typename Range>
+        struct is_contiguous_range_<Range, std::void_t<decltype(std::size(std::declval<Range const&>())),
+                                                       decltype(std::data(std::declval<Range const&>()))>> :
+            std::is_convertible<decltype(std::data(std::declval<Range const&>())), const_pointer>
+        {
+        };
+
+        // trivially copyable value_type only: one memmove for the tail, one memcpy for the block
+        inline iterator insert_block_(difference_type index, const_pointer first, size_type count)
+        {
+            static_assert(std::is_trivially_copyable<value_type>::value);
+            if (count == 0)
+                return begin() + index;
+
+            // source is inside this vector and would be invalidated by realloc
+            if (std::less_equal<const_pointer>()(data(), first) && 
+                std::less<const_pointer>()(first, data() + size_))
             {
-                storage_.realloc((current_capacity + 1) / 2, size_);
-                return;
+                vector copy;
+                if (!copy.reserve_(count))
+                    return end();
+
+                std::memcpy(static_cast<void*>(copy.data()), static_cast<void const*>(first), count * sizeof(value_type));
+                copy.size_ = count;
+                return insert_block_(index, copy.data(), count);
             }
 
-            auto new_capacity = current_capacity;
-            while (new_size >= new_capacity)
-                new_capacity = std::max(new_capacity * 2, static_cast<size_type>(1));
-            
-            storage_.realloc(new_capacity, size_);
+            if (!realloc_if_needed_(count))
+                return end();
+
+            std::memmove(static_cast<void*>(data() + index + count), static_cast<void const*>(data() + index), 
+                         (size_ - index) * sizeof(value_type));
+            std::memcpy(static_cast<void*>(data() + index), static_cast<void const*>(first), 
+                        count * sizeof(value_type));
+
+            size_ += count;
+            return begin() + index;
         }
 
-        inline void create_default_(difference_type start, size_t count)
+        // element-wise move for storages that can`t give their buffer away
+        inline void move_from_(vector& origin)
         {
-            for (difference_type i = 0; i != static_cast<difference_type>(count); i++)
-                storage_.create(i);
+            auto size = reserve_at_most_(origin.size_);
+
+            difference_type i = 0;
+            try
+            {
+                for (; i != size; i++)
+                    storage_.create(i, std::move(origin.at_unchecked(i)));
+                
+                size_ = i;
+            }
+            catch (...)
+            {
+                for (; i > 0;)
+                    storage_.destroy(--i);
+
+                size_ = i;
+                throw; // up
+            }
         }
 
         inline void move_tail_(difference_type start, difference_type shift)
@@ -687,7 +872,7 @@ namespace jules
         // inline void reserve(size_type new_capacity)
         explicit vector(size_type size = 0)
         {
-            reserve(size);
+            size = reserve_at_most_(size);
             difference_type i = 0;
             try
             {
@@ -706,10 +891,16 @@ namespace jules
             }
         }
 
+        explicit vector(size_type size, default_init_t)
+        {
+            size = reserve_at_most_(size);
+            grow_for_overwrite_(size);
+        }
+
         template<typename... Args>
         explicit vector(size_type size, Args&&... args)
         {
-            reserve(size);
+            size = reserve_at_most_(size);
             difference_type i = 0;
             try
             {
@@ -731,13 +922,12 @@ namespace jules
         // not explicit!
         vector(std::initializer_list<value_type> list)
         {
-            auto size = list.size();
-            reserve(size);
+            auto size = reserve_at_most_(list.size());
 
             difference_type i = 0;
             try
             {
-                for (auto it = list.begin(); it != list.end(); ++it, i++)
+                for (auto it = list.begin(); i != size; ++it, i++)
                     storage_.create(i, std::move(*it));
                 
                 size_ = i;
@@ -754,8 +944,7 @@ namespace jules
 
         vector(vector const& origin)
         {
-            auto size = origin.size_;
-            reserve(size);
+            auto size = reserve_at_most_(origin.size_);
 
             difference_type i = 0;
             try
@@ -775,27 +964,17 @@ namespace jules
             }
         }
 
-        vector(vector&& origin)
+        vector(vector&& origin) noexcept(nothrow_movable_)
         {
-            auto size = origin.size_;
-            reserve(size);
-
-            difference_type i = 0;
-            try
+            if constexpr (storage_type::is_stealable)
             {
-                for (; i != size; i++)
-                    storage_.create(i, std::move(origin.at_unchecked(i)));
-                
-                size_ = i;
+                storage_.steal(origin.storage_, origin.size_);
+                size_ = origin.size_;
+                origin.size_ = 0;
             }
-            catch (...)
-            {
-                for (; i > 0;)
-                    storage_.destroy(--i);
 
-                size_ = i;
-                throw; // up
-            }
+            else
+                move_from_(origin);
         }
 
         // void clear() noexcept;
@@ -807,8 +986,11 @@ namespace jules
 
         vector& operator=(vector const& origin)
         {
+            if (this == &origin)
+                return *this;
+
             clear();
-            auto size = origin.size_;
+            auto size = reserve_at_most_(origin.size_);
 
             difference_type i = 0;
             try
@@ -830,12 +1012,22 @@ namespace jules
             return *this;
         }
         
-        vector& operator=(vector&& origin)
+        vector& operator=(vector&& origin) noexcept(nothrow_movable_)
         {
+            if (this == &origin)
+                return *this;
+
             clear();
 
-            storage_.swap(origin.storage_);
-            size_ = origin.size_;
+            if constexpr (storage_type::is_stealable)
+            {
+                storage_.steal(origin.storage_, origin.size_);
+                size_ = origin.size_;
+                origin.size_ = 0;
+            }
+
+            else
+                move_from_(origin);
 
             return *this;
         }
@@ -843,13 +1035,12 @@ namespace jules
         vector& operator=(std::initializer_list<value_type> list)
         {
             clear();
-            auto size = list.size();
-            reserve(size);
+            auto size = reserve_at_most_(list.size());
 
             difference_type i = 0;
             try
             {
-                for (auto it = list.begin(); it != list.end(); it++, i++)
+                for (auto it = list.begin(); i != size; it++, i++)
                     storage_.create(i, std::move(*it));
                 
                 size_ = i;
@@ -928,18 +1119,33 @@ namespace jules
             return const_cast<pointer>(static_cast<vector const*>(this)->data());
         }
 
+        // data() the compiler knows to be aligned to alignment (the storage`s
+        // guarantee), so kernels over it may use aligned loads
+        [[nodiscard]] inline const_pointer aligned_data() const noexcept
+        {
+            return static_cast<const_pointer>(__builtin_assume_aligned(data(), alignment));
+        }
+
+        [[nodiscard]] inline pointer aligned_data() noexcept
+        {
+            return static_cast<pointer>(__builtin_assume_aligned(data(), alignment));
+        }
+
         //
         // Iterators
         //
+        // Raw pointers unless JULES_CHECKED_ITERATORS is defined, then every
+        // dereference goes through bounds checked operator[].
+        //
 
         iterator begin()
         {
-            return iterator(*this, 0);
+            return iterator_at_(0);
         }
 
         const_iterator cbegin() const
         {
-            return const_iterator(*this, 0);
+            return iterator_at_(0);
         }
 
         const_iterator begin() const
@@ -949,12 +1155,20 @@ namespace jules
 
         reverse_iterator rbegin()
         {
+#ifdef JULES_CHECKED_ITERATORS
             return reverse_iterator(*this, 0);
+#else
+            return reverse_iterator(end());
+#endif
         }
 
         const_reverse_iterator crbegin() const
         {
+#ifdef JULES_CHECKED_ITERATORS
             return const_reverse_iterator(*this, 0);
+#else
+            return const_reverse_iterator(cend());
+#endif
         }
 
         const_reverse_iterator rbegin() const
@@ -966,12 +1180,12 @@ namespace jules
 
         iterator end()
         {
-            return iterator(*this, size_);
+            return iterator_at_(size_);
         }
 
         const_iterator cend() const
         {
-            return const_iterator(*this, size_);
+            return iterator_at_(size_);
         }
 
         const_iterator end() const
@@ -981,12 +1195,20 @@ namespace jules
 
         reverse_iterator rend()
         {
+#ifdef JULES_CHECKED_ITERATORS
             return reverse_iterator(*this, size_);
+#else
+            return reverse_iterator(begin());
+#endif
         }
 
         const_reverse_iterator crend() const
         {
+#ifdef JULES_CHECKED_ITERATORS
             return const_reverse_iterator(*this, size_);
+#else
+            return const_reverse_iterator(cbegin());
+#endif
         }
 
         const_reverse_iterator rend() const
@@ -1015,8 +1237,7 @@ namespace jules
 
         inline void reserve(size_type new_capacity)
         {
-            if (new_capacity > storage_.capacity())
-                storage_.realloc(new_capacity, size_);
+            static_cast<void>(reserve_(new_capacity));
         }
 
         [[nodiscard]] inline size_type capacity() const noexcept
@@ -1051,10 +1272,9 @@ namespace jules
 
         inline void resize(size_type new_size)
         {
+            new_size = reserve_at_most_(new_size);
             if (new_size == size_)
                 return;
-            
-            reserve(new_size);
 
             if (new_size > size_)
             {
@@ -1082,16 +1302,45 @@ namespace jules
                     storage_.destroy(--i);
 
                 size_ = new_size;
-                shrink_to_fit();
+                shrink_if_needed_();
+            }
+        }
+
+        // as resize, but new elements are default-initialized, so trivial ones
+        // keep whatever the memory held; meant for buffers overwritten right away
+        inline void resize_for_overwrite(size_type new_size)
+        {
+            if (new_size <= size_)
+            {
+                resize(new_size);
+                return;
             }
+
+            grow_for_overwrite_(reserve_at_most_(new_size));
+        }
+
+        // appends count default-initialized elements (growing by the policy)
+        // and returns pointer to the first of them
+        [[nodiscard]] inline pointer reserve_and_expose(size_type count)
+        {
+            auto index = size_;
+            if (!realloc_if_needed_(count))
+                return nullptr;
+
+            grow_for_overwrite_(size_ + count);
+            return data() + index;
         }
 
         // no nodiscard!
         template<typename... Args>
         inline reference emplace_back(Args&&... args)
         {
-            realloc_if_needed_();
-            storage_.create(static_cast<difference_type>(size_++), std::forward<Args>(args)...);
+            // dropped on a full fixed capacity vector, back() is returned then
+            if (!realloc_if_needed_())
+                return back();
+
+            storage_.create(static_cast<difference_type>(size_), std::forward<Args>(args)...);
+            size_++;
             return back();
         }
 
@@ -1109,15 +1358,17 @@ namespace jules
         {
             check_index_(0, "vector::pop_back()");
             storage_.destroy(static_cast<difference_type>(size_ - 1));
-            realloc_if_needed_(-1);
             size_--;
+            shrink_if_needed_();
         }
 
         inline iterator insert(const_iterator position, T const& value)
         {
             check_iterator_(position, "vector::insert(const_iterator, T const&)");
-            realloc_if_needed_();
-            auto index = position - begin();
+            auto index = index_of_(position);
+            if (!realloc_if_needed_())
+                return end();
+
             move_tail_(index, 1);
             if (!is_created_(index))
                 storage_.create(index, value);
@@ -1130,8 +1381,10 @@ namespace jules
         inline iterator insert(const_iterator position, T&& value)
         {
             check_iterator_(position, "vector::insert(const_iterator, T&&)");
-            realloc_if_needed_();
-            auto index = position - begin();
+            auto index = index_of_(position);
+            if (!realloc_if_needed_())
+                return end();
+
             move_tail_(index, 1);
 
             if (!is_created_(index))
@@ -1146,12 +1399,13 @@ namespace jules
         inline iterator insert(const_iterator position, size_type count, T const& value)
         {
             if (count == 0)
-                return iterator(*this, position.index_);
+                return begin() + index_of_(position);
 
             check_iterator_(position, "vector::insert(const_iterator, size_type, T const&)");
-            realloc_if_needed_(count);
+            auto index = index_of_(position);
+            if (!realloc_if_needed_(count))
+                return end();
 
-            auto index = position - begin();
             move_tail_(index, static_cast<difference_type>(count));
             for (auto i = index; i != index + count; i++)
             {
@@ -1166,19 +1420,39 @@ namespace jules
             return begin() + index;
         }
 
+        // forward iterators are counted first, single pass ones are appended
+        // one by one and rotated into place; iterators are only compared by ==
         template<typename It>
         inline iterator insert(const_iterator position, It first, It last)
         {
-            if (!(first < last))
-                return iterator(*this, position.index_);
-
             check_iterator_(position, "vector::insert(const_iterator, It, It)");
-            auto count = last - first;
-            realloc_if_needed_(count);
-            auto index = position - begin();            
+            auto index = index_of_(position);
+
+            using category = typename std::iterator_traits<It>::iterator_category;
+            if constexpr (!std::is_base_of<std::forward_iterator_tag, category>::value)
+            {
+                auto old_size = size_;
+                for (; first != last; ++first)
+                    emplace_back(*first);
+
+                std::rotate(begin() + index, begin() + old_size, end());
+                return begin() + index;
+            }
+
+            auto count = static_cast<size_type>(std::distance(first, last));
+            if (count == 0)
+                return begin() + index;
+
+            if constexpr (std::is_trivially_copyable<value_type>::value && 
+                          std::is_convertible<It, const_pointer>::value)
+                return insert_block_(index, first, count);
+
+            if (!realloc_if_needed_(count))
+                return end();
+
             move_tail_(index, static_cast<difference_type>(count));
             for (auto i = index; 
-                 i != index + count && first < last; 
+                 i != index + count; 
                  i++, ++first)
             {
                 if (!is_created_(i))
@@ -1196,9 +1470,13 @@ namespace jules
         {
             check_iterator_(position, "vector::insert(const_iterator, std::initializer_list<T>)");
             auto count = list.size();
-            realloc_if_needed_(static_cast<difference_type>(count));
+            auto index = index_of_(position);
+            if constexpr (std::is_trivially_copyable<value_type>::value)
+                return insert_block_(index, list.begin(), count);
+
+            if (!realloc_if_needed_(count))
+                return end();
 
-            auto index = position - begin();
             move_tail_(index, static_cast<difference_type>(count));
             auto it = list.begin();
             for (auto i = index; i != index + count; i++, ++it)
@@ -1214,18 +1492,39 @@ namespace jules
             return begin() + index;
         }
 
+        // Range is anything with std::begin / std::end. Contiguous ranges
+        // (jules::vector, std::vector, std::array, raw arrays) of trivially
+        // copyable value_type are inserted with a single memmove + memcpy.
+        template<typename Range>
+        inline iterator insert_range(const_iterator position, Range const& range)
+        {
+            check_iterator_(position, "vector::insert_range(const_iterator, Range const&)");
+            if constexpr (std::is_trivially_copyable<value_type>::value && 
+                          is_contiguous_range_<Range>::value)
+                return insert_block_(index_of_(position), std::data(range), std::size(range));
+
+            else
+                return insert(position, std::begin(range), std::end(range));
+        }
+
+        template<typename Range>
+        inline void append_range(Range const& range)
+        {
+            insert_range(cend(), range);
+        }
+
         inline iterator erase(const_iterator first, const_iterator last)
         {
             check_iterator_(first, "vector::erase(const_iterator, const_iterator): first");
             check_iterator_(last, "vector::erase(const_iterator, const_iterator): second");
 
             if (!(first < last))
-                return iterator(*this, last.index_);
+                return begin() + index_of_(last);
 
             auto count = last - first;
-            auto index = first.index_;
+            auto index = index_of_(first);
 
-            move_tail_(last.index_, -count);
+            move_tail_(index_of_(last), -count);
             for (auto i = size_ - count; i != size_; i++)
                 storage_.destroy(i);
             
@@ -1237,22 +1536,28 @@ namespace jules
         {
             return erase(position, position + 1);
         }
+
+        inline void swap(vector& other) noexcept(nothrow_movable_)
+        {
+            storage_.swap(other.storage_, size_, other.size_);
+            std::swap(size_, other.size_);
+        }
     };
 
-    template<class Allocator, template<typename, size_t, class> class Storage>
-    class vector<bool, Allocator, Storage>
+    template<class Allocator, template<typename, size_t, class> class Storage, class Growth>
+    class vector<bool, Allocator, Storage, Growth>
     {
     protected:
     struct __bool_ref
     {
-        friend class vector<bool, Allocator, Storage>;
+        friend class vector<bool, Allocator, Storage, Growth>;
         __bool_ref(__bool_ref const&) = default; // not explicit
         __bool_ref(__bool_ref&&) = default; // not explicit
 
         __bool_ref& operator=(bool value) noexcept
         {
-            (*octet_) &= ~(1 << bit_);
-            (*octet_) |= (1 << bit_) * value;
+            auto mask = uint64_t(1) << bit_;
+            (*word_) = ((*word_) & ~mask) | (mask * value);
             return *this;
         }
 
@@ -1270,75 +1575,79 @@ namespace jules
 
         operator bool() const noexcept
         {
-            return ((*octet_) >> bit_) & 0x1;
+            return ((*word_) >> bit_) & 0x1;
         }     
 
 
     private:
-        __bool_ref(uint8_t& octet, size_t bit) noexcept :
-            octet_(&octet), bit_(bit)
+        __bool_ref(uint64_t& word, size_t bit) noexcept :
+            word_(&word), bit_(bit)
         {
         }
 
-        static __bool_ref create_(uint8_t* data, size_t index)
+        static __bool_ref create_(uint64_t* data, size_t index)
         {
-            return __bool_ref(data[index >> 3], index & 7ull);
+            return __bool_ref(data[index >> 6], index & 63ull);
         }
 
     private:
-            uint8_t* octet_;
+            uint64_t* word_;
             size_t const bit_;
     };
 
     struct __bool_const_ref
     {
-        friend class vector<bool, Allocator, Storage>;
+        friend class vector<bool, Allocator, Storage, Growth>;
         __bool_const_ref(__bool_const_ref const&) = default; // not explicit
 
         operator bool() const noexcept
         {
-            return (octet_ >> bit_) & 0x1;
+            return (word_ >> bit_) & 0x1;
         }
 
         
         private:
-        __bool_const_ref(uint8_t const& octet, size_t bit) noexcept :
-            octet_(octet), bit_(bit)
+        __bool_const_ref(uint64_t const& word, size_t bit) noexcept :
+            word_(word), bit_(bit)
         {
         }
 
-        static __bool_const_ref create_(uint8_t const* data, size_t index)
+        static __bool_const_ref create_(uint64_t const* data, size_t index)
         {
-            return __bool_const_ref(data[index >> 3], index & 7ull);
+            return __bool_const_ref(data[index >> 6], index & 63ull);
         }
 
         private:
-            uint8_t const& octet_;
+            uint64_t const& word_;
             size_t const bit_;
     };
 
         static_assert(Allocator::is_raw, "Allocator for vector must be raw!");
+        static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, 
+            "vector<bool>: data() octet view relies on little endian words!");
     public:
         using value_type           = bool;
-        using real_type            = uint8_t;
-        using allocator_type       = jules::allocator::Default<real_type, true>;
+        using word_type            = uint64_t;
+        using real_type            = word_type;
+        using allocator_type       = jules::allocator::rebind_t<Allocator, word_type>;
         using size_type            = std::size_t;
         using difference_type      = std::ptrdiff_t;
         static size_type const initial_capacity
                                    = 0;
-        using storage_type         = Storage<real_type, initial_capacity, allocator_type>;
+        using storage_type         = Storage<word_type, initial_capacity, allocator_type>;
+        using growth_policy        = Growth;
         using reference            = __bool_ref;
         using const_reference      = __bool_const_ref;
-        using pointer              = real_type*;
-        using const_pointer        = real_type const*;
+        using pointer              = uint8_t*;
+        using const_pointer        = uint8_t const*;
 
         class __vector_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
-            using pointer              = pointer;
-            using reference            = reference;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
+            using pointer              = typename vector::pointer;
+            using reference            = typename vector::reference;
             using iterator_category    = std::random_access_iterator_tag;
 
         protected:
@@ -1464,8 +1773,8 @@ namespace jules
         class __vector_const_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
             using pointer              = const_pointer;
             using reference            = const_reference;
             using iterator_category    = std::random_access_iterator_tag;
@@ -1599,10 +1908,10 @@ namespace jules
         class __vector_reverse_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
-            using pointer              = pointer;
-            using reference            = reference;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
+            using pointer              = typename vector::pointer;
+            using reference            = typename vector::reference;
             using iterator_category    = std::random_access_iterator_tag;
 
         protected:
@@ -1733,8 +2042,8 @@ namespace jules
         class __vector_reverse_const_iterator
         {
         public:
-            using value_type           = value_type;
-            using difference_type      = difference_type;
+            using value_type           = typename vector::value_type;
+            using difference_type      = typename vector::difference_type;
             using pointer              = const_pointer;
             using reference            = const_reference;
             using iterator_category    = std::random_access_iterator_tag;
@@ -1876,17 +2185,26 @@ namespace jules
                                    = __vector_reverse_const_iterator;
 
     protected:
+        static size_type const word_bits_
+                                   = 8 * sizeof(word_type);
+        static word_type const all_ones_
+                                   = std::numeric_limits<word_type>::max();
+
         storage_type storage_;
         size_type size_ = 0;
+        mutable std::shared_ptr<jules::bits::watch> watch_;     // null until watch() is asked for
+
+        // bits past size_ in the last word are always zero, so words
+        // may be compared, copied and counted whole
 
-        inline size_type octets_number_(size_type bits)
+        static inline size_type words_number_(size_type bits) noexcept
         {
-            return (bits + 8 * sizeof(real_type) - 1) / (8 * sizeof(real_type));
+            return (bits + word_bits_ - 1) / word_bits_;
         }
 
-        inline size_type octet_by_bit_(size_type bit)
+        static inline size_type word_by_bit_(size_type bit) noexcept
         {
-            return bit / (8 * sizeof(real_type));
+            return bit / word_bits_;
         }
 
         inline void check_index_(difference_type index, char const* fnc) const
@@ -1909,108 +2227,195 @@ namespace jules
                 check_index_(it.index_, fnc);
         }
 
-        inline bool is_created_(difference_type i)
+        // false if count more bits still don`t fit (fixed capacity
+        // storage with a dropping overflow policy), nothing is to be added then
+        [[nodiscard]] inline bool realloc_if_needed_(size_type count = 1)
+        {    
+            auto current_capacity = storage_.capacity();
+            auto new_words = words_number_(size_ + count);
+            assert(size_ <= current_capacity * word_bits_);
+
+            if (new_words <= current_capacity)
+                return true;
+
+            storage_.realloc(growth_policy::grow(current_capacity, new_words, sizeof(word_type)), 
+                             words_number_(size_));
+            touched_();
+            return new_words <= storage_.capacity();
+        }
+
+        [[nodiscard]] inline bool reserve_(size_type new_capacity)
         {
-            return octet_by_bit_(i) < octets_number_(size_);
+            if (new_capacity > capacity())
+            {
+                storage_.realloc(words_number_(new_capacity), words_number_(size_));
+                touched_();
+            }
+
+            return new_capacity <= capacity();
         }
 
-        inline void realloc_if_needed_(difference_type size_diff = 1)
-        {    
+        // reserves count bits and returns how many of them fit
+        [[nodiscard]] inline size_type reserve_at_most_(size_type count)
+        {
+            return reserve_(count) ? count : capacity();
+        }
+
+        // call after size_ went down
+        inline void shrink_if_needed_()
+        {
             auto current_capacity = storage_.capacity();
-            auto new_size = size_ + size_diff;
-            if (size_diff < 0)
+            auto words = words_number_(size_);
+            auto new_capacity = growth_policy::shrink(current_capacity, words, sizeof(word_type));
+            if (new_capacity < current_capacity)
+            {
+                storage_.realloc(new_capacity, words);
+                touched_();
+            }
+        }
+
+        // sets [size_, new_size) to value and size_ to new_size, capacity must be enough
+        inline void grow_filled_(size_type new_size, bool value)
+        {
+            assert(new_size <= capacity());
+            if (new_size <= size_)
+                return;
+
+            auto words = word_data();
+            auto used = words_number_(size_);
+            if (value && size_ % word_bits_ != 0)
+                words[used - 1] |= all_ones_ << (size_ % word_bits_);
+
+            std::memset(static_cast<void*>(words + used), value ? 0xFF : 0x00, 
+                        (words_number_(new_size) - used) * sizeof(word_type));
+            size_ = new_size;
+            touched_();
+            clear_tail_();
+        }
+
+        // call after any change to size_ or the buffer and before handing
+        // out mutable words; a null check unless somebody watches
+        inline void touched_() noexcept
+        {
+            if (watch_)
             {
-                assert(-size_diff < size_);
+                watch_->words = storage_.data();
+                watch_->size = size_;
+                watch_->generation++;
             }
+        }
 
-            assert(size_ <= current_capacity * 8 * sizeof(real_type));
+        // zeroes bits past size_ in the last word
+        inline void clear_tail_() noexcept
+        {
+            if (size_ % word_bits_ != 0)
+                word_data()[size_ / word_bits_] &= ~(all_ones_ << (size_ % word_bits_));
+        }
 
-            if (octets_number_(new_size * 4) <= current_capacity && current_capacity > 0)
+        // size_ must be 0
+        inline void copy_words_(vector const& origin)
+        {
+            auto size = reserve_at_most_(origin.size_);
+            if (size != 0)
+                std::memcpy(static_cast<void*>(word_data()), static_cast<void const*>(origin.word_data()),
+                            words_number_(size) * sizeof(word_type));
+            size_ = size;
+            touched_();
+            clear_tail_();
+        }
+
+        template<class Op>
+        inline vector& combine_(vector const& other)
+        {
+            if (other.size_ > size_)
+                resize(other.size_);
+
+            // other may still be longer if the resize was cut short
+            jules::bits::combine<Op>(word_data(), other.word_data(),
+                                     std::min(other.word_count(), word_count()), word_count());
+            clear_tail_();
+            return *this;
+        }
+
+        template<typename It>
+        inline void assign_bits_(It first, size_type count)
+        {
+            count = reserve_at_most_(count);
+            auto words = word_data();
+            word_type word = 0;
+            for (size_type i = 0; i != count; i++, ++first)
             {
-                auto size = (size_diff < 0) ? size_ + size_diff : size_;
-                storage_.realloc((current_capacity + 1) / 2, octets_number_(size));
-                return;
+                word |= static_cast<word_type>(!!(*first)) << (i % word_bits_);
+                if (i % word_bits_ == word_bits_ - 1)
+                {
+                    words[i / word_bits_] = word;
+                    word = 0;
+                }
             }
 
-            auto new_capacity = current_capacity;
-            while (octets_number_(new_size) >= new_capacity)
-                new_capacity = std::max(new_capacity * 2, static_cast<size_type>(1));
-            
-            auto size = (size_diff < 0) ? size_ - size_diff : size_;
-            storage_.realloc(new_capacity, octets_number_(size));
+            if (count % word_bits_ != 0)
+                words[count / word_bits_] = word;
+            size_ = count;
+            touched_();
         }
 
+        // [start, size_) goes to [start + shift, size_ + shift) by whole words,
+        // bits made free are unspecified; for shift > 0 capacity must be enough
         inline void move_tail_(difference_type start, difference_type shift)
         {
             if (shift == 0)
                 return;
 
+            auto words = word_data();
             if (shift < 0)
-                for (difference_type i = start; i != size_; i++)
-                    at_unchecked(i + shift) = std::move(at_unchecked(i));
+                jules::bits::move_down(words, start, size_, -shift);
             
             else
-                for (difference_type i = size_ - 1; i >= start; i--)
-                {
-                    if (!is_created_(i + shift))
-                        storage_.create(i + shift);
+            {
+                auto new_size = size_ + shift;
+                for (auto i = words_number_(size_); i < words_number_(new_size); i++)
+                    words[i] = 0;
 
-                    at_unchecked(i + shift) = std::move(at_unchecked(i));
-                }
+                jules::bits::move_up(words, start, size_, shift);
+            }
         }
 
     public:
         // inline void reserve(size_type new_capacity)
         explicit vector(size_type size = 0)
         {
-            reserve(size);
-            difference_type i = 0;
-            for (; i < size; i += 8 * sizeof(real_type))
-                storage_.create(i / (8 * sizeof(real_type)));
-                
-            size_ = i;
+            grow_filled_(reserve_at_most_(size), false);
         }
 
         template<typename... Args>
         explicit vector(size_type size, Args&&... args)
         {
-            bool value = bool(std::forward<Args>(args)...);
-            real_type fill = value ? std::numeric_limits<real_type>::max() : 0;
-            reserve(size);
-            difference_type i = 0;
-            for (; i < size; i += 8 * sizeof(real_type))
-                storage_.create(octet_by_bit_(i), fill);
-                
-            size_ = i;
+            grow_filled_(reserve_at_most_(size), bool(std::forward<Args>(args)...));
         }
 
         // not explicit!
-        vector(std::initializer_list<value_type> list) :
-            size_(list.size())
+        vector(std::initializer_list<value_type> list)
         {
-            reserve(size_);
-
-            difference_type i = 0;
-            for (auto it = list.begin(); it != list.end(); ++it, i++)
-                at_unchecked(i) = !!(*it);
+            assign_bits_(list.begin(), list.size());
         }
 
-        vector(vector const& origin) noexcept :
-            size_(origin.size_)
+        vector(vector const& origin)
         {
-            reserve(size_);
-
-            for (difference_type i = 0; i != octets_number_(size_); i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));
+            copy_words_(origin);
         }
 
-        vector(vector&& origin) :
-            size_(origin.size_)
+        vector(vector&& origin) noexcept(storage_type::is_stealable)
         {
-            reserve(size_);
+            if constexpr (storage_type::is_stealable)
+            {
+                storage_.steal(origin.storage_, words_number_(origin.size_));
+                size_ = origin.size_;
+                origin.size_ = 0;
+                origin.touched_();
+            }
 
-            for (difference_type i = 0; i != octets_number_(size_); i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));
+            else
+                copy_words_(origin);
         }
 
         // void clear() noexcept;
@@ -2022,39 +2427,46 @@ namespace jules
 
         vector& operator=(vector const& origin)
         {
-            reserve(origin.size_);
-            size_ = origin.size_;
-
-            for (difference_type i = 0; i != octets_number_(size_); i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));         
+            if (this == &origin)
+                return *this;
 
+            clear();
+            copy_words_(origin);
             return *this;
         }
         
-        vector& operator=(vector&& origin)
+        vector& operator=(vector&& origin) noexcept(storage_type::is_stealable)
         {
-            reserve(origin.size_);
-            size_ = origin.size_;
+            if (this == &origin)
+                return *this;
+
+            clear();
+            if constexpr (storage_type::is_stealable)
+            {
+                storage_.steal(origin.storage_, words_number_(origin.size_));
+                size_ = origin.size_;
+                origin.size_ = 0;
+                touched_();
+                origin.touched_();
+            }
 
-            for (difference_type i = 0; i != octets_number_(size_); i++)
-                storage_.create(i, origin.storage_.at_unchecked(i));         
+            else
+                copy_words_(origin);
 
             return *this;
         }
 
         vector& operator=(std::initializer_list<value_type> list)
         {
-            reserve(list.size());
-            size_ = list.size();
-
-            difference_type i = 0;
-            for (auto it = list.begin(); it != list.end(); it++, i++)
-                at_unchecked(i) = *it;
-
+            assign_bits_(list.begin(), list.size());
             return *this;
         }
 
-        // TODO: assign
+        inline void assign(size_type count, value_type const& value)
+        {
+            clear();
+            grow_filled_(reserve_at_most_(count), value);
+        }
 
         [[nodiscard]] inline allocator_type get_allocator() const
         {
@@ -2107,16 +2519,47 @@ namespace jules
             return operator[](size_ - 1);
         }
 
+        // bit i is bit i % 8 of octet i / 8, as it always was
         [[nodiscard]] inline const_pointer data() const noexcept
         {
-            return storage_.data();
+            return reinterpret_cast<const_pointer>(storage_.data());
         }
 
         [[nodiscard]] inline pointer data() noexcept
         {
+            touched_();
             return const_cast<pointer>(static_cast<vector const*>(this)->data());
         }
 
+        // bit i is bit i % 64 of word i / 64
+        [[nodiscard]] inline word_type const* word_data() const noexcept
+        {
+            return storage_.data();
+        }
+
+        // counts as a write, the words may change through it
+        [[nodiscard]] inline word_type* word_data() noexcept
+        {
+            touched_();
+            return const_cast<word_type*>(static_cast<vector const*>(this)->word_data());
+        }
+
+        // for indexes over the words (rank_select), see bits::watch;
+        // single bit writes through reference are not counted
+        [[nodiscard]] inline std::shared_ptr<jules::bits::watch const> watch() const
+        {
+            if (!watch_)
+                watch_ = std::make_shared<jules::bits::watch>(
+                    jules::bits::watch{ storage_.data(), size_, 0 });
+
+            return watch_;
+        }
+
+        [[nodiscard]] inline size_type word_count() const noexcept
+        {
+            return words_number_(size_);
+        }
+
         //
         // Iterators
         //
@@ -2204,18 +2647,18 @@ namespace jules
 
         inline void reserve(size_type new_capacity)
         {
-            if (new_capacity > storage_.capacity() * sizeof(real_type))
-                storage_.realloc(octets_number_(new_capacity), octets_number_(size_));
+            static_cast<void>(reserve_(new_capacity));
         }
 
         [[nodiscard]] inline size_type capacity() const noexcept
         {
-            return storage_.capacity() * sizeof(real_type) * 8;
+            return storage_.capacity() * word_bits_;
         }
 
         inline void shrink_to_fit()
         {
-            storage_.realloc(octets_number_(size_), octets_number_(size_));
+            storage_.realloc(words_number_(size_), words_number_(size_));
+            touched_();
         }
 
         //
@@ -2224,38 +2667,56 @@ namespace jules
 
         inline void clear() noexcept
         {
-            
+            size_ = 0;
+            touched_();
         }
 
-        inline void resize(size_type new_size)
+        inline void resize(size_type new_size, value_type const& value = false)
         {
             if (new_size == size_)
                 return;
             
-            reserve(new_size);
-
             if (new_size > size_)
-            {
-                size_type i = size_;
-                for (size_type i = size_; i != new_size; i++)
-                    at_unchecked(i) = false;
-                
-                size_ = new_size;
-            }
+                grow_filled_(reserve_at_most_(new_size), value);
 
             else
             {
                 size_ = new_size;
-                shrink_to_fit();
+                touched_();
+                clear_tail_();
+                shrink_if_needed_();
             }
         }
 
+        // sets every bit to value
+        inline void fill(value_type const& value) noexcept
+        {
+            if (size_ == 0)
+                return;
+
+            std::memset(static_cast<void*>(word_data()), value ? 0xFF : 0x00, word_count() * sizeof(word_type));
+            clear_tail_();
+        }
+
+        inline void flip() noexcept
+        {
+            jules::bits::invert(word_data(), word_count());
+            clear_tail_();
+        }
+
         // no nodiscard!
         template<typename... Args>
         inline reference emplace_back(Args&&... args)
         {
-            realloc_if_needed_();
+            // dropped on a full fixed capacity vector, back() is returned then
+            if (!realloc_if_needed_())
+                return back();
+
+            if (size_ % word_bits_ == 0)
+                word_data()[size_ / word_bits_] = 0;
+
             size_++;
+            touched_();
             back() = bool(std::forward<Args>(args)...);
             return back();
         }
@@ -2273,32 +2734,39 @@ namespace jules
         inline void pop_back()
         {
             check_index_(0, "vector::pop_back()");
-            storage_.destroy(static_cast<difference_type>(size_ - 1));
-            realloc_if_needed_(-1);
             size_--;
+            touched_();
+            clear_tail_();
+            shrink_if_needed_();
         }
 
         inline iterator insert(const_iterator position, value_type const& value)
         {
             check_iterator_(position, "vector::insert(const_iterator, value_type const&)");
-            realloc_if_needed_();
+            if (!realloc_if_needed_())
+                return end();
+
             auto index = position - begin();
             move_tail_(index, 1);
             at_unchecked(index) = value;
             size_++;
+            touched_();
             return begin() + index;
         }
 
         inline iterator insert(const_iterator position, value_type&& value)
         {
             check_iterator_(position, "vector::insert(const_iterator, value_type&&)");
-            realloc_if_needed_();
+            if (!realloc_if_needed_())
+                return end();
+
             auto index = position - begin();
             move_tail_(index, 1);
 
             at_unchecked(index) = std::move(value);
 
             size_++;
+            touched_();
             return begin() + index;
         }
 
@@ -2308,38 +2776,52 @@ namespace jules
                 return iterator(*this, position.index_);
 
             check_iterator_(position, "vector::insert(const_iterator, size_type, value_type const&)");
-            realloc_if_needed_(count);
+            if (!realloc_if_needed_(count))
+                return end();
 
             auto index = position - begin();
             move_tail_(index, static_cast<difference_type>(count));
-            for (auto i = index; i != index + count; i++)
-            {
-                at_unchecked(i) = value;
-            }
+            jules::bits::fill_range(word_data(), index, index + count, value);
 
             size_ += count;
+            touched_();
             return begin() + index;
         }
 
+        // single pass iterators are read into a temporary first
         template<typename It>
         inline iterator insert(const_iterator position, It first, It last)
         {
-            if (!(first < last))
+            check_iterator_(position, "vector::insert(const_iterator, It, It)");
+
+            using category = typename std::iterator_traits<It>::iterator_category;
+            if constexpr (!std::is_base_of<std::forward_iterator_tag, category>::value)
+            {
+                vector buffered;
+                for (; first != last; ++first)
+                    buffered.push_back(*first);
+
+                return insert(position, buffered.begin(), buffered.end());
+            }
+
+            auto count = static_cast<size_type>(std::distance(first, last));
+            if (count == 0)
                 return iterator(*this, position.index_);
 
-            check_iterator_(position, "vector::insert(const_iterator, It, It)");
-            auto count = last - first;
-            realloc_if_needed_(count);
-            auto index = position - begin();            
+            if (!realloc_if_needed_(count))
+                return end();
+
+            auto index = position - begin();
             move_tail_(index, static_cast<difference_type>(count));
             for (auto i = index; 
-                 i != index + count && first < last; 
+                 i != index + count; 
                  i++, ++first)
             {
                 at_unchecked(i) = *first;
             }
 
             size_ += count;
+            touched_();
             return begin() + index;
         }
 
@@ -2347,7 +2829,8 @@ namespace jules
         {
             check_iterator_(position, "vector::insert(const_iterator, std::initializer_list<value_type>)");
             auto count = list.size();
-            realloc_if_needed_(static_cast<difference_type>(count));
+            if (!realloc_if_needed_(count))
+                return end();
 
             auto index = position - begin();
             move_tail_(index, static_cast<difference_type>(count));
@@ -2358,6 +2841,7 @@ namespace jules
             }
 
             size_ += count;
+            touched_();
             return begin() + index;
         }
 
@@ -2373,8 +2857,10 @@ namespace jules
             auto index = first.index_;
 
             move_tail_(last.index_, -count);
-            realloc_if_needed_(-static_cast<difference_type>(count));
             size_ -= count;
+            touched_();
+            clear_tail_();
+            shrink_if_needed_();
 
             return begin() + index;
         }
@@ -2383,5 +2869,194 @@ namespace jules
         {
             return erase(position, position + 1);
         }
+
+        inline void swap(vector& other) noexcept(storage_type::is_stealable)
+        {
+            storage_.swap(other.storage_, words_number_(size_), words_number_(other.size_));
+            std::swap(size_, other.size_);
+            touched_();
+            other.touched_();
+        }
+
+        //
+        // Bitwise, the shorter operand is zero-extended and the result
+        // has the longer size; shifts keep the size
+        //
+
+        inline vector& operator&=(vector const& other)
+        {
+            return combine_<jules::bits::op_and>(other);
+        }
+
+        inline vector& operator|=(vector const& other)
+        {
+            return combine_<jules::bits::op_or>(other);
+        }
+
+        inline vector& operator^=(vector const& other)
+        {
+            return combine_<jules::bits::op_xor>(other);
+        }
+
+        // this &= ~other
+        inline vector& andnot(vector const& other)
+        {
+            return combine_<jules::bits::op_andnot>(other);
+        }
+
+        // bit i goes to i + shift, bits pushed past size() are lost
+        inline vector& operator<<=(size_type shift) noexcept
+        {
+            jules::bits::shift_up(word_data(), word_count(), shift);
+            clear_tail_();
+            return *this;
+        }
+
+        // bit i goes to i - shift, top bits become zero
+        inline vector& operator>>=(size_type shift) noexcept
+        {
+            jules::bits::shift_down(word_data(), word_count(), shift);
+            return *this;
+        }
+
+        [[nodiscard]] inline vector operator~() const
+        {
+            auto result = *this;
+            result.flip();
+            return result;
+        }
+
+        [[nodiscard]] friend inline vector operator&(vector lhs, vector const& rhs)
+        {
+            lhs &= rhs;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline vector operator|(vector lhs, vector const& rhs)
+        {
+            lhs |= rhs;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline vector operator^(vector lhs, vector const& rhs)
+        {
+            lhs ^= rhs;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline vector andnot(vector lhs, vector const& rhs)
+        {
+            lhs.andnot(rhs);
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline vector operator<<(vector lhs, size_type shift) noexcept
+        {
+            lhs <<= shift;
+            return lhs;
+        }
+
+        [[nodiscard]] friend inline vector operator>>(vector lhs, size_type shift) noexcept
+        {
+            lhs >>= shift;
+            return lhs;
+        }
+
+        //
+        // Set bit iteration, cost follows count() rather than size()
+        //
+
+        template<typename Fn>
+        inline void for_each_set_bit(Fn&& fn) const
+        {
+            jules::bits::for_each_set(word_data(), size_, std::forward<Fn>(fn));
+        }
+
+        // skips empty 256 bit blocks, for very sparse bits
+        template<typename Fn>
+        inline void for_each_set_bit_sparse(Fn&& fn) const
+        {
+            jules::bits::for_each_set_sparse(word_data(), size_, std::forward<Fn>(fn));
+        }
+
+        // four positions per step, for dense bits
+        template<typename Fn>
+        inline void for_each_set_bit_dense(Fn&& fn) const
+        {
+            jules::bits::for_each_set_dense(word_data(), size_, std::forward<Fn>(fn));
+        }
+
+        // for (auto i : v.set_bits()), valid while this is alive and unchanged
+        [[nodiscard]] inline jules::bits::set_bit_range set_bits() const noexcept
+        {
+            return jules::bits::set_bit_range(word_data(), size_);
+        }
+
+        //
+        // Bit queries, searches return size() when nothing is found
+        //
+
+        [[nodiscard]] inline size_type count() const noexcept
+        {
+            return jules::bits::count(word_data(), size_);
+        }
+
+        [[nodiscard]] inline bool any() const noexcept
+        {
+            return jules::bits::any(word_data(), size_);
+        }
+
+        [[nodiscard]] inline bool none() const noexcept
+        {
+            return jules::bits::none(word_data(), size_);
+        }
+
+        [[nodiscard]] inline size_type find_first() const noexcept
+        {
+            return jules::bits::find_first(word_data(), size_);
+        }
+
+        // first set bit at pos or after it
+        [[nodiscard]] inline size_type find_next(size_type pos) const noexcept
+        {
+            return jules::bits::find_next(word_data(), size_, pos);
+        }
+
+        [[nodiscard]] inline size_type find_first_clear() const noexcept
+        {
+            return jules::bits::find_first_clear(word_data(), size_);
+        }
+
+        [[nodiscard]] inline size_type find_next_clear(size_type pos) const noexcept
+        {
+            return jules::bits::find_next_clear(word_data(), size_, pos);
+        }
+
+        //
+        // Comparison
+        //
+
+        // whole words, tails are zero
+        [[nodiscard]] friend inline bool operator==(vector const& lhs, vector const& rhs) noexcept
+        {
+            return lhs.size_ == rhs.size_ &&
+                   (lhs.size_ == 0 ||
+                    std::memcmp(lhs.word_data(), rhs.word_data(), lhs.word_count() * sizeof(word_type)) == 0);
+        }
+
+        [[nodiscard]] friend inline bool operator!=(vector const& lhs, vector const& rhs) noexcept
+        {
+            return !(lhs == rhs);
+        }
     };
+
+    // first N elements need no allocation at all
+    template<typename T, size_t N, class Allocator = jules::allocator::Default<T, true>,
+                                   class Growth = jules::growth::doubling>
+    using small_vector = vector<T, Allocator, storage::hybrid<N>::template type, Growth>;
+
+    // capacity N forever, never calls an allocator
+    template<typename T, size_t N, class Overflow = jules::overflow::throws, size_t Alignment = 0>
+    using static_vector = vector<T, jules::allocator::Empty<T, true>, storage::fixed<N, Overflow, Alignment>::template type,
+                                    jules::growth::never_shrink<>>;
 }
\ No newline at end of file
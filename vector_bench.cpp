@@ -0,0 +1,1079 @@
+/*++
+
+Copyright (c) 2022 JulesIMF, MIPT
+
+Module Name:
+
+    vector_bench.cpp
+
+Abstract:
+
+    Benchmarks for jules::vector.
+
+Author / Creation date:
+
+    JulesIMF / 17.10.26
+
+Revision History:
+
+--*/
+
+
+//
+// Includes / usings
+//
+
+#include "vector.hpp"
+#include <bench.hpp>
+#include "array.hpp"
+#include "atomic_bitset.hpp"
+#include "rank_select.hpp"
+#include "roaring.hpp"
+#include "packed_vector.hpp"
+#include "bit_span.hpp"
+#include "arena.hpp"
+#include "thread_cache.hpp"
+#include "huge_pages.hpp"
+#include <algorithm>
+#include <bitset>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+//
+// Defines
+//
+
+struct Pod
+{
+    int x, y, z;
+    double w;
+};
+
+// same layout, but relocated element by element
+struct SlowPod : Pod
+{
+};
+
+template<>
+struct jules::is_trivially_relocatable<SlowPod> : std::false_type
+{
+};
+
+// owns a block: moving nulls the source, the destructor frees it
+struct Handle
+{
+    void* block = nullptr;
+
+    Handle() = default;
+
+    Handle(Handle&& other) noexcept :
+        block(other.block)
+    {
+        other.block = nullptr;
+    }
+
+    ~Handle()
+    {
+        if (block != nullptr)
+            std::free(block);
+    }
+};
+
+// same, but declared relocatable: a memcpy leaves nothing to destroy
+struct RelocatableHandle : Handle
+{
+    RelocatableHandle() = default;
+    RelocatableHandle(RelocatableHandle&&) = default;
+};
+
+template<>
+struct jules::is_trivially_relocatable<RelocatableHandle> : std::true_type
+{
+};
+
+template<typename T>
+static void relocate_(jules::vector<T>& v, int rounds)
+{
+    // each round relocates the whole buffer twice
+    for (int i = 0; i != rounds; i++)
+    {
+        v.reserve(v.size() * 2);
+        v.shrink_to_fit();
+    }
+}
+
+void relocation()
+{
+    jules::bench::start("relocation");
+    size_t const n = 1 << 14;
+
+    jules::vector<SlowPod> slow_v(n);
+    jules::vector<Pod> fast_v(n);
+
+    auto slow = jules::bench::measure("reserve / shrink_to_fit, element-wise",
+        [&]
+        {
+            relocate_(slow_v, 1000);
+        });
+
+    auto fast = jules::bench::measure("reserve / shrink_to_fit, as bytes",
+        [&]
+        {
+            relocate_(fast_v, 1000);
+        });
+
+    jules::bench::speedup(slow, fast);
+
+    // non-trivial move and destructor, from L1 sized buffers to DRAM sized;
+    // as bytes means realloc, which mostly resizes in place (mremap when big)
+    for (size_t size : { size_t(1) << 10, size_t(1) << 16, size_t(1) << 22 })
+    {
+        jules::vector<Handle> moved(size);
+        jules::vector<RelocatableHandle> copied(size);
+        int const rounds = static_cast<int>((size_t(1) << 26) / size);
+
+        char name[64];
+        snprintf(name, sizeof(name), "2^%d handles, move + destroy", __builtin_ctzll(size));
+        auto moves = jules::bench::measure(name,
+            [&]
+            {
+                relocate_(moved, rounds);
+            });
+
+        snprintf(name, sizeof(name), "2^%d handles, as bytes", __builtin_ctzll(size));
+        auto copies = jules::bench::measure(name,
+            [&]
+            {
+                relocate_(copied, rounds);
+            });
+
+        jules::bench::speedup(moves, copies);
+    }
+
+    jules::bench::complete();
+}
+
+template<class Growth>
+static void oscillate_(size_t base, size_t amplitude, int rounds)
+{
+    jules::vector<int, jules::allocator::Default<int, true>, jules::storage::on_heap, Growth> v;
+    for (size_t i = 0; i != base; i++)
+        v.push_back(i);
+
+    for (int round = 0; round != rounds; round++)
+    {
+        for (size_t i = 0; i != amplitude; i++)
+            v.push_back(i);
+
+        for (size_t i = 0; i != amplitude; i++)
+            v.pop_back();
+    }
+}
+
+template<class Growth>
+static void oscillation_workloads_(char const* name)
+{
+    printf("%s:\n", name);
+
+    jules::bench::measure("  push / pop 1 around 2^16",
+        [&]
+        {
+            oscillate_<Growth>(1 << 16, 1, 1 << 20);
+        });
+
+    jules::bench::measure("  push / pop 2^10 around 2^16",
+        [&]
+        {
+            oscillate_<Growth>(1 << 16, 1 << 10, 1 << 10);
+        });
+
+    jules::bench::measure("  fill / drain 2^16",
+        [&]
+        {
+            oscillate_<Growth>(0, 1 << 16, 1 << 4);
+        });
+}
+
+void growth_policies()
+{
+    jules::bench::start("growth_policies");
+
+    oscillation_workloads_<jules::growth::doubling>("doubling");
+    oscillation_workloads_<jules::growth::one_and_half>("one_and_half");
+    oscillation_workloads_<jules::growth::page_rounded<>>("page_rounded");
+    oscillation_workloads_<jules::growth::never_shrink<>>("never_shrink");
+
+    jules::bench::complete();
+}
+
+void bulk_append()
+{
+    jules::bench::start("bulk_append");
+    std::vector<int> chunk(1 << 15);
+    for (size_t i = 0; i != chunk.size(); i++)
+        chunk[i] = i;
+
+    jules::vector<int> v;
+    auto slow = jules::bench::measure("push_back loop, 64 chunks of 2^15",
+        [&]
+        {
+            v.clear();
+            for (int i = 0; i != 64; i++)
+                for (auto x : chunk)
+                    v.push_back(x);
+        });
+
+    auto fast = jules::bench::measure("append_range, 64 chunks of 2^15",
+        [&]
+        {
+            v.clear();
+            for (int i = 0; i != 64; i++)
+                v.append_range(chunk);
+        });
+
+    jules::bench::speedup(slow, fast);
+    jules::bench::complete();
+}
+
+void bool_words()
+{
+    jules::bench::start("bool_words");
+    size_t const n = 1 << 26;
+
+    std::vector<bool> std_a(n), std_b(n);
+    jules::vector<bool> a(n), b(n);
+
+    auto slow = jules::bench::measure("std::vector<bool> fill + resize + compare, 2^26 bits",
+        [&]
+        {
+            std_a.assign(n, true);
+            std_b.assign(n, true);
+            std_a.resize(n / 2);
+            std_a.resize(n, true);
+            if (std_a != std_b)
+                printf("mismatch\n");
+        });
+
+    auto fast = jules::bench::measure("jules::vector<bool> fill + resize + compare, 2^26 bits",
+        [&]
+        {
+            a.assign(n, true);
+            b.assign(n, true);
+            a.resize(n / 2);
+            a.resize(n, true);
+            if (a != b)
+                printf("mismatch\n");
+        });
+
+    jules::bench::speedup(slow, fast);
+    jules::bench::complete();
+}
+
+template<typename Count, typename Scan>
+static void scan_workloads_(char const* name, Count count, Scan scan)
+{
+    printf("%s:\n", name);
+    size_t sink = 0;
+
+    jules::bench::measure("  count x100",
+        [&]
+        {
+            for (int i = 0; i != 100; i++)
+                sink += count();
+        });
+
+    jules::bench::measure("  visit every set bit x100",
+        [&]
+        {
+            for (int i = 0; i != 100; i++)
+                sink += scan();
+        });
+
+    if (sink == 42)
+        printf("\n");
+}
+
+void bit_scans()
+{
+    jules::bench::start("bit_scans");
+    size_t const n = 1 << 20;
+
+    std::vector<bool> std_v(n);
+    auto std_set = std::make_unique<std::bitset<n>>();
+    jules::vector<bool> v(n);
+    auto arr = std::make_unique<jules::array<bool, n, jules::storage::on_heap>>(n);
+
+    // sparse: one bit in 1000
+    for (size_t i = 0; i < n; i += 1000)
+        std_v[i] = (*std_set)[i] = v[i] = (*arr)[i] = true;
+
+    scan_workloads_("std::vector<bool>",
+        [&] { return static_cast<size_t>(std::count(std_v.begin(), std_v.end(), true)); },
+        [&]
+        {
+            size_t last = 0;
+            for (auto it = std::find(std_v.begin(), std_v.end(), true); it != std_v.end();
+                 it = std::find(it + 1, std_v.end(), true))
+                last = it - std_v.begin();
+            return last;
+        });
+
+    scan_workloads_("std::bitset",
+        [&] { return std_set->count(); },
+        [&]
+        {
+            size_t last = 0;
+            for (auto i = std_set->_Find_first(); i != n; i = std_set->_Find_next(i))
+                last = i;
+            return last;
+        });
+
+    scan_workloads_("jules::vector<bool>",
+        [&] { return v.count(); },
+        [&]
+        {
+            size_t last = 0;
+            for (auto i = v.find_first(); i != n; i = v.find_next(i + 1))
+                last = i;
+            return last;
+        });
+
+    scan_workloads_("jules::array<bool>",
+        [&] { return arr->count(); },
+        [&]
+        {
+            size_t last = 0;
+            for (auto i = arr->find_first(); i != n; i = arr->find_next(i + 1))
+                last = i;
+            return last;
+        });
+
+    jules::bench::complete();
+}
+
+void bitwise()
+{
+    jules::bench::start("bitwise");
+    size_t const n = 1 << 20;
+
+    std::vector<bool> std_a(n), std_b(n);
+    auto set_a = std::make_unique<std::bitset<n>>();
+    auto set_b = std::make_unique<std::bitset<n>>();
+    jules::vector<bool> a(n), b(n);
+
+    for (size_t i = 0; i < n; i += 3)
+        std_b[i] = (*set_b)[i] = b[i] = true;
+
+    auto slow = jules::bench::measure("std::vector<bool> &= |= ^= <<= 1, element loop x10",
+        [&]
+        {
+            for (int round = 0; round != 10; round++)
+            {
+                for (size_t i = 0; i != n; i++)
+                    std_a[i] = std_a[i] & std_b[i];
+                for (size_t i = 0; i != n; i++)
+                    std_a[i] = std_a[i] | std_b[i];
+                for (size_t i = 0; i != n; i++)
+                    std_a[i] = std_a[i] ^ std_b[i];
+                for (size_t i = n - 1; i != 0; i--)
+                    std_a[i] = std_a[i - 1];
+                std_a[0] = false;
+            }
+        });
+
+    auto bitset = jules::bench::measure("std::bitset &= |= ^= <<= 1 x10",
+        [&]
+        {
+            for (int round = 0; round != 10; round++)
+            {
+                *set_a &= *set_b;
+                *set_a |= *set_b;
+                *set_a ^= *set_b;
+                *set_a <<= 1;
+            }
+        });
+
+    auto fast = jules::bench::measure("jules::vector<bool> &= |= ^= <<= 1 x10",
+        [&]
+        {
+            for (int round = 0; round != 10; round++)
+            {
+                a &= b;
+                a |= b;
+                a ^= b;
+                a <<= 1;
+            }
+        });
+
+    jules::bench::speedup(slow, fast);
+    jules::bench::speedup(bitset, fast);
+    jules::bench::complete();
+}
+
+void bool_front_edits()
+{
+    jules::bench::start("bool_front_edits");
+    size_t const n = 1 << 24;
+
+    std::vector<bool> std_v(n);
+    jules::vector<bool> v(n);
+
+    auto slow = jules::bench::measure("std::vector<bool> insert / erase at front, 2^24 bits x10",
+        [&]
+        {
+            for (int i = 0; i != 10; i++)
+            {
+                std_v.insert(std_v.begin() + 3, true);
+                std_v.erase(std_v.begin() + 5);
+            }
+        });
+
+    auto fast = jules::bench::measure("jules::vector<bool> insert / erase at front, 2^24 bits x10",
+        [&]
+        {
+            for (int i = 0; i != 10; i++)
+            {
+                v.insert(v.begin() + 3, true);
+                v.erase(v.begin() + 5);
+            }
+        });
+
+    jules::bench::speedup(slow, fast);
+    jules::bench::complete();
+}
+
+static void visit_workloads_(size_t step)
+{
+    size_t const n = 1 << 22;
+    std::vector<bool> std_v(n);
+    jules::vector<bool> v(n);
+    for (size_t i = 0; i < n; i += step)
+        std_v[i] = v[i] = true;
+
+    printf("one bit in %zu:\n", step);
+    size_t sink = 0;
+
+    auto slow = jules::bench::measure("  std::vector<bool> walk every bit",
+        [&]
+        {
+            for (size_t i = 0; i != n; i++)
+                if (std_v[i])
+                    sink += i;
+        });
+
+    auto plain = jules::bench::measure("  for_each_set_bit",
+        [&]
+        {
+            v.for_each_set_bit([&](size_t i) { sink += i; });
+        });
+
+    jules::bench::measure("  for_each_set_bit_sparse",
+        [&]
+        {
+            v.for_each_set_bit_sparse([&](size_t i) { sink += i; });
+        });
+
+    jules::bench::measure("  for_each_set_bit_dense",
+        [&]
+        {
+            v.for_each_set_bit_dense([&](size_t i) { sink += i; });
+        });
+
+    jules::bench::measure("  set_bits() range",
+        [&]
+        {
+            for (auto i : v.set_bits())
+                sink += i;
+        });
+
+    jules::bench::speedup(slow, plain);
+    if (sink == 42)
+        printf("\n");
+}
+
+void set_bit_visits()
+{
+    jules::bench::start("set_bit_visits");
+    visit_workloads_(4096);
+    visit_workloads_(64);
+    visit_workloads_(2);
+    jules::bench::complete();
+}
+
+void rank_select()
+{
+    jules::bench::start("rank_select");
+    size_t const n = 1 << 24;
+    size_t const queries = 1 << 12;
+
+    jules::vector<bool> v(n);
+    for (size_t i = 0; i < n; i += 3)
+        v[i] = true;
+
+    jules::rank_select index;
+    jules::bench::measure("build over 2^24 bits",
+        [&]
+        {
+            index.rebuild(v);
+        });
+
+    size_t sink = 0;
+    auto slow = jules::bench::measure("rank by counting the prefix, 2^12 queries",
+        [&]
+        {
+            for (size_t q = 0; q != queries; q++)
+                sink += jules::bits::count(v.word_data(), q * (n / queries));
+        });
+
+    auto fast = jules::bench::measure("rank by index, 2^12 queries",
+        [&]
+        {
+            for (size_t q = 0; q != queries; q++)
+                sink += index.rank(q * (n / queries));
+        });
+
+    jules::bench::speedup(slow, fast);
+
+    jules::bench::measure("select by index, 2^12 queries",
+        [&]
+        {
+            for (size_t q = 0; q != queries; q++)
+                sink += index.select(q * (index.ones() / queries));
+        });
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+void roaring()
+{
+    jules::bench::start("roaring");
+    size_t const n = size_t(1) << 26;
+
+    // sparse set and a half dense one
+    jules::vector<bool> sparse(n), dense(n);
+    uint64_t seed = 4242;
+    for (size_t i = 0; i != n; i++)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        if ((seed >> 33) % 1000 == 0)
+            sparse[i] = true;
+    }
+
+    for (size_t i = 0; i < n; i += 2)
+        dense[i] = true;
+
+    jules::roaring_bitmap a(sparse), b(dense);
+    printf("2^26 bits, 0.1%% set: %zu KB as vector<bool>, %zu KB as roaring_bitmap\n",
+           sparse.word_count() * 8 / 1024, a.memory() / 1024);
+
+    jules::bench::measure("from vector<bool>, sparse + dense",
+        [&]
+        {
+            a = jules::roaring_bitmap(sparse);
+            b = jules::roaring_bitmap(dense);
+        });
+
+    jules::bench::measure("to vector<bool>, sparse + dense",
+        [&]
+        {
+            sparse = a.to_vector();
+            dense = b.to_vector();
+        });
+
+    size_t sink = 0;
+    auto slow = jules::bench::measure("vector<bool> sparse & dense",
+        [&]
+        {
+            sink += (sparse & dense).count();
+        });
+
+    auto fast = jules::bench::measure("roaring_bitmap sparse & dense",
+        [&]
+        {
+            sink += (a & b).count();
+        });
+
+    jules::bench::speedup(slow, fast);
+
+    jules::bench::measure("roaring dense | dense (bitmaps)",
+        [&]
+        {
+            sink += (b | b).count();
+        });
+
+    jules::bench::measure("roaring sparse | sparse (arrays)",
+        [&]
+        {
+            sink += (a | a).count();
+        });
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+void atomic_bitset()
+{
+    jules::bench::start("atomic_bitset");
+    size_t const n = 1 << 22;
+    size_t const probes = 1 << 22;
+
+    auto plain = std::make_unique<jules::array<bool, n, jules::storage::on_heap>>(n);
+    auto shared = std::make_unique<jules::atomic_bitset<n, jules::storage::on_heap>>(n);
+    for (size_t i = 0; i < n; i += 3)
+    {
+        (*plain)[i] = true;
+        shared->set(i);
+    }
+
+    size_t sink = 0;
+    auto base = jules::bench::measure("array<bool> reads, 2^22 probes",
+        [&]
+        {
+            for (size_t i = 0; i != probes; i++)
+                sink += (*plain)[(i * 7919) % n];
+        });
+
+    auto relaxed = jules::bench::measure("atomic_bitset relaxed reads, 2^22 probes",
+        [&]
+        {
+            for (size_t i = 0; i != probes; i++)
+                sink += shared->test((i * 7919) % n);
+        });
+
+    jules::bench::speedup(base, relaxed);
+
+    jules::bench::measure("atomic_bitset test_and_set, 2^22 probes",
+        [&]
+        {
+            for (size_t i = 0; i != probes; i++)
+                sink += shared->test_and_set((i * 7919) % n);
+        });
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+void packed_vector()
+{
+    jules::bench::start("packed_vector");
+    size_t const n = 1 << 24;
+
+    jules::vector<uint32_t> values(n);
+    uint64_t seed = 99;
+    for (size_t i = 0; i != n; i++)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        values[i] = static_cast<uint32_t>(seed >> 52);
+    }
+
+    jules::packed_vector<12> packed;
+    printf("2^24 values of 12 bits: %zu MB as uint32_t, %zu MB packed\n",
+           n * 4 >> 20, (n * 12 / 8) >> 20);
+
+    auto slow_pack = jules::bench::measure("push_back one by one",
+        [&]
+        {
+            packed.clear();
+            for (size_t i = 0; i != n; i++)
+                packed.push_back(values[i]);
+        });
+
+    auto fast_pack = jules::bench::measure("append (bulk pack)",
+        [&]
+        {
+            packed.clear();
+            packed.append(values);
+        });
+
+    jules::bench::speedup(slow_pack, fast_pack);
+
+    auto slow_unpack = jules::bench::measure("operator[] one by one",
+        [&]
+        {
+            for (size_t i = 0; i != n; i++)
+                values[i] = packed[i];
+        });
+
+    auto fast_unpack = jules::bench::measure("unpack (bulk)",
+        [&]
+        {
+            packed.unpack(0, n, values.data());
+        });
+
+    jules::bench::speedup(slow_unpack, fast_unpack);
+
+    size_t sink = 0;
+    jules::bench::measure("random reads, 2^22",
+        [&]
+        {
+            for (size_t i = 0; i != (1 << 22); i++)
+                sink += packed[(i * 7919) % n];
+        });
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+void bit_span()
+{
+    jules::bench::start("bit_span");
+    size_t const n = 1 << 26;
+
+    jules::vector<bool> v(n);
+    for (size_t i = 0; i < n; i += 5)
+        v[i] = true;
+
+    size_t sink = 0;
+    auto copy = jules::bench::measure("count of a slice, copied out",
+        [&]
+        {
+            jules::vector<bool> slice;
+            slice.reserve(n / 2);
+            for (size_t i = n / 4; i != n / 4 + n / 2; i++)
+                slice.push_back(v[i]);
+
+            sink += slice.count();
+        });
+
+    auto aligned = jules::bench::measure("count of a slice, aligned span",
+        [&]
+        {
+            sink += jules::const_bit_span(v, n / 4, n / 2).count();
+        });
+
+    jules::bench::speedup(copy, aligned);
+
+    jules::bench::measure("count of a slice, span at bit 3",
+        [&]
+        {
+            sink += jules::const_bit_span(v, n / 4 + 3, n / 2).count();
+        });
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+// one "request": dozens of temporary vectors that die together
+template<class Allocator>
+static size_t request_(size_t seed)
+{
+    using vector = jules::vector<int, Allocator>;
+    size_t sum = 0;
+    jules::vector<vector, jules::allocator::Default<vector, true>> temporaries;
+    for (size_t i = 0; i != 48; i++)
+    {
+        temporaries.emplace_back();
+        auto& v = temporaries.back();
+        for (size_t j = 0; j != 16 + (seed * (i + 1)) % 200; j++)
+            v.push_back(static_cast<int>(i + j));
+
+        sum += v.size();
+    }
+
+    return sum;
+}
+
+void arena()
+{
+    jules::bench::start("arena");
+    size_t const requests = 2000;
+
+    size_t sink = 0;
+    auto heap = jules::bench::measure("2000 requests, malloc",
+        [&]
+        {
+            for (size_t r = 0; r != requests; r++)
+                sink += request_<jules::allocator::Default<int, true>>(r);
+        });
+
+    jules::allocator::arena arena;
+    auto bump = jules::bench::measure("2000 requests, arena + reset",
+        [&]
+        {
+            for (size_t r = 0; r != requests; r++)
+            {
+                {
+                    jules::allocator::arena::scope use(arena);
+                    sink += request_<jules::allocator::Arena<int, true>>(r);
+                }
+
+                arena.reset();
+            }
+        });
+
+    jules::bench::speedup(heap, bump);
+    printf("arena chunk kept between requests: %zu KB\n", arena.reserved() / 1024);
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+// node churn: a window of live nodes, oldest freed as new ones come
+template<class Allocator>
+static size_t node_churn_(size_t nodes)
+{
+    struct node
+    {
+        node* next;
+        size_t value;
+    };
+
+    typename jules::allocator::rebind<Allocator, node>::type allocator;
+    jules::vector<node*> window(4096);
+    size_t sum = 0;
+    for (size_t i = 0; i != nodes; i++)
+    {
+        auto& slot = window[(i * 2654435761u) % window.size()];
+        if (slot != nullptr)
+        {
+            sum += slot->value;
+            allocator.deallocate(slot, 1);
+        }
+
+        slot = allocator.allocate(1);
+        slot->value = i;
+    }
+
+    for (auto slot : window)
+        if (slot != nullptr)
+            allocator.deallocate(slot, 1);
+
+    return sum;
+}
+
+void pool()
+{
+    jules::bench::start("pool");
+    size_t const nodes = 1 << 21;
+
+    size_t sink = 0;
+    auto heap = jules::bench::measure("2^21 node allocations, malloc",
+        [&]
+        {
+            sink += node_churn_<jules::allocator::Default<int, true>>(nodes);
+        });
+
+    auto slabs = jules::bench::measure("2^21 node allocations, pool",
+        [&]
+        {
+            sink += node_churn_<jules::allocator::Pool<int, true>>(nodes);
+        });
+
+    jules::bench::speedup(heap, slabs);
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+// one worker: vectors grown from empty and dropped, a few kept alive
+template<class Allocator>
+static size_t grow_and_free_(size_t seed, size_t rounds)
+{
+    using vector = jules::vector<int, Allocator>;
+    jules::vector<vector> live(16);
+    size_t sum = 0;
+    for (size_t r = 0; r != rounds; r++)
+    {
+        vector v;
+        for (size_t j = 0; j != 1 + (seed + r * 2654435761u) % 1500; j++)
+            v.push_back(static_cast<int>(j));
+
+        sum += v.size();
+        std::swap(v, live[r % live.size()]);
+    }
+
+    return sum;
+}
+
+// the same work per thread, every thread count
+template<class Allocator>
+static double grow_and_free_threads_(size_t threads, char const* allocator, size_t& sink)
+{
+    char name[64];
+    snprintf(name, sizeof(name), "%zu threads, %s", threads, allocator);
+    return jules::bench::measure(name,
+        [&]
+        {
+            jules::vector<size_t> sums(threads);
+            jules::vector<std::thread> workers;
+            for (size_t t = 0; t != threads; t++)
+                workers.emplace_back([&sums, t] { sums[t] = grow_and_free_<Allocator>(t, 20000); });
+
+            for (auto& worker : workers)
+                worker.join();
+
+            for (auto sum : sums)
+                sink += sum;
+        }, 3);
+}
+
+void thread_cache()
+{
+    jules::bench::start("thread_cache");
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (max_threads < 4)
+        max_threads = 4;
+    if (max_threads > 32)
+        max_threads = 32;
+
+    printf("%zu hardware threads, 20000 vectors per thread\n", static_cast<size_t>(std::thread::hardware_concurrency()));
+
+    size_t sink = 0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        auto heap = grow_and_free_threads_<jules::allocator::Default<int, true>>(threads, "malloc", sink);
+        auto cached = grow_and_free_threads_<jules::allocator::ThreadCache<int, true>>(threads, "thread cache", sink);
+        jules::bench::speedup(heap, cached);
+    }
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+// y += 0.5 x over aligned_data(), 16 KB vectors stay in L1
+template<class Allocator>
+static float axpy_(size_t rounds)
+{
+    jules::vector<float, Allocator> x, y;
+    for (size_t i = 0; i != 4096; i++)
+    {
+        x.push_back(static_cast<float>(i % 7));
+        y.push_back(static_cast<float>(i % 5));
+    }
+
+    for (size_t r = 0; r != rounds; r++)
+    {
+        auto a = x.aligned_data();
+        auto b = y.aligned_data();
+        for (size_t i = 0; i != x.size(); i++)
+            b[i] += 0.5f * a[i];
+    }
+
+    return y[rounds % y.size()];
+}
+
+void aligned()
+{
+    jules::bench::start("aligned");
+    size_t const rounds = 100000;
+
+    float sink = 0;
+    auto heap = jules::bench::measure("4096 float axpy, malloc",
+        [&]
+        {
+            sink += axpy_<jules::allocator::Default<float, true>>(rounds);
+        });
+
+    auto lines = jules::bench::measure("4096 float axpy, Aligned<64>",
+        [&]
+        {
+            sink += axpy_<jules::allocator::Aligned<float, true, 64>>(rounds);
+        });
+
+    jules::bench::speedup(heap, lines);
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+// kB of the process backed by transparent huge pages, -1 if unknown
+static long anon_huge_kb_()
+{
+    auto file = fopen("/proc/self/smaps_rollup", "r");
+    if (file == nullptr)
+        return -1;
+
+    char line[256];
+    long kb = -1;
+    while (fgets(line, sizeof(line), file) != nullptr)
+        if (sscanf(line, "AnonHugePages: %ld kB", &kb) == 1)
+            break;
+
+    fclose(file);
+    return kb;
+}
+
+// dependent loads at random over a 1 GB table, each one a TLB miss with 4 KB pages
+template<class Allocator>
+static double random_reads_(char const* name, size_t& sink)
+{
+    size_t const size = size_t(1) << 27;
+    jules::vector<uint64_t, Allocator> table(size, 0);
+    for (size_t i = 0; i != size; i++)
+        table[i] = i * 2654435761u;
+
+    auto time = jules::bench::measure(name,
+        [&]
+        {
+            uint64_t x = 1;
+            size_t i = 0;
+            for (size_t r = 0; r != size_t(1) << 22; r++)
+            {
+                x = x * 6364136223846793005u + 1442695040888963407u;
+                i = (i + (x >> 20) + table[i]) & (size - 1);
+            }
+
+            sink += i;
+        });
+
+    printf("%-40s %10ld kB\n", "AnonHugePages", anon_huge_kb_());
+    return time;
+}
+
+void huge_pages()
+{
+    jules::bench::start("huge_pages");
+
+    size_t sink = 0;
+    auto small = random_reads_<jules::allocator::Default<uint64_t, true>>("2^22 random reads of 1 GB, malloc", sink);
+    auto huge = random_reads_<jules::allocator::HugePages<uint64_t, true>>("2^22 random reads of 1 GB, THP", sink);
+    jules::bench::speedup(small, huge);
+
+    if (sink == 42)
+        printf("\n");
+
+    jules::bench::complete();
+}
+
+int main()
+{
+    relocation();
+    growth_policies();
+    bulk_append();
+    bool_words();
+    bit_scans();
+    bitwise();
+    bool_front_edits();
+    set_bit_visits();
+    rank_select();
+    roaring();
+    atomic_bitset();
+    packed_vector();
+    bit_span();
+    arena();
+    pool();
+    thread_cache();
+    aligned();
+    huge_pages();
+}
@@ -24,10 +24,27 @@ Revision History:
 //
 
 #include "vector.hpp"
+#include "on_mmap.hpp"
+#include "rank_select.hpp"
+#include "roaring.hpp"
+#include "packed_vector.hpp"
+#include "bit_span.hpp"
+#include "arena.hpp"
+#include "thread_cache.hpp"
+#include "huge_pages.hpp"
+#include "array.hpp"
 #include <string>
+#include <cstring>
+#include <cstdlib>
 #include <algorithm>
+#include <deque>
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <vector>
 #include <dbg.hpp>
 #include <iostream>
+#include <thread>
 
 //
 // Defines
@@ -111,8 +128,24 @@ void default_config_int()
             auto mv = std::move(v);
             for (int i = 0; i != 5; i++)
                 std::cout << mv[i] << " ";
+
+            v = std::move(mv);
+            for (int i = 0; i != 5; i++)
+                std::cout << v[i] << " ";
         },
-            "0 1 2 3 4 ");
+            "0 1 2 3 4 0 1 2 3 4 ");
+
+    jules::tests::test("move steals buffer",
+        [&]
+        {
+            auto data = v.data();
+            auto mv = std::move(v);
+            std::cout << (mv.data() == data) << " " << v.size() << " " << v.capacity() << " ";
+
+            v = std::move(mv);
+            std::cout << (v.data() == data) << " " << mv.size() << " " << v.size();
+        },
+            "1 0 0 1 0 5");
 
     jules::tests::test("copy ctr",
         [&]
@@ -320,6 +353,23 @@ void iterator_tests()
         },
             "aaa");
 
+    jules::tests::test("iterators are contiguous",
+        [&]
+        {
+            std::cout << (&*v.begin() == v.data()) << " ";
+            std::cout << (&*(v.begin() + 3) == v.data() + 3) << " ";
+            std::cout << (v.end() - v.begin());
+        },
+            "1 1 5");
+
+#ifdef JULES_CHECKED_ITERATORS
+    jules::tests::test_exception("checked iterators",
+        [&]
+        {
+            *v.end() = 0;
+        });
+#endif
+
     jules::tests::complete();
 }
 
@@ -473,8 +523,12 @@ void default_config_bool()
             auto mv = std::move(v);
             for (int i = 0; i != 5; i++)
                 std::cout << mv[i] << " ";
+
+            v = std::move(mv);
+            for (int i = 0; i != 5; i++)
+                std::cout << v[i] << " ";
         },
-            "0 1 0 1 0 ");
+            "0 1 0 1 0 0 1 0 1 0 ");
 
     jules::tests::test("copy ctr",
         [&]
@@ -626,6 +680,2142 @@ void emplace_insert_remove_bool()
     jules::tests::complete();
 }
 
+void growth_policies()
+{
+    jules::tests::start("growth_policies");
+
+    jules::tests::test("push / pop around capacity keeps buffer",
+        [&]
+        {
+            jules::vector<int> v;
+            while (v.size() != v.capacity() || v.size() < 64)
+                v.push_back(0);
+
+            v.push_back(0);
+            auto data = v.data();
+            for (int i = 0; i != 1000; i++)
+            {
+                v.pop_back();
+                v.push_back(0);
+            }
+
+            std::cout << (v.data() == data);
+        },
+            "1");
+
+    jules::tests::test("shrinks at a quarter",
+        [&]
+        {
+            jules::vector<int> v;
+            for (int i = 0; i != 1024; i++)
+                v.push_back(i);
+
+            auto capacity = v.capacity();
+            while (v.size() * 4 > capacity)
+                v.pop_back();
+
+            std::cout << (v.capacity() < capacity) << " " << (v.capacity() >= v.size() * 2);
+        },
+            "1 1");
+
+    jules::tests::test("one and half",
+        [&]
+        {
+            using policy = jules::growth::one_and_half;
+            jules::vector<int, jules::allocator::Default<int, true>, 
+                          jules::storage::on_heap, policy> v;
+            for (int i = 0; i != 100; i++)
+                v.push_back(i);
+
+            std::cout << policy::grow(16, 17, sizeof(int)) << " " << policy::grow(16, 100, sizeof(int)) << " " << v[99];
+        },
+            "24 121 99");
+
+    jules::tests::test("page rounded",
+        [&]
+        {
+            using policy = jules::growth::page_rounded<>;
+            jules::vector<int, jules::allocator::Default<int, true>, 
+                          jules::storage::on_heap, policy> v;
+            for (int i = 0; i != 1500; i++)
+                v.push_back(i);
+
+            std::cout << (policy::grow(1024, 1500, sizeof(int)) * sizeof(int)) % 4096 << " ";
+            std::cout << (policy::grow(8, 9, sizeof(int)) * sizeof(int)) << " " << v[1499];
+        },
+            "0 64 1499");
+
+    jules::tests::test("never shrink",
+        [&]
+        {
+            jules::vector<int, jules::allocator::Default<int, true>, 
+                          jules::storage::on_heap, jules::growth::never_shrink<>> v;
+            for (int i = 0; i != 1024; i++)
+                v.push_back(i);
+
+            auto capacity = v.capacity();
+            while (!v.empty())
+                v.pop_back();
+
+            std::cout << (v.capacity() == capacity);
+            v.shrink_to_fit();
+            std::cout << v.capacity();
+        },
+            "10");
+
+    jules::tests::complete();
+}
+
+void bulk_insert()
+{
+    jules::tests::start("bulk_insert");
+
+    jules::vector<int> v = { 0, 1, 2 };
+    auto dump = [&]
+    {
+        for (auto x : v)
+            std::cout << x << " ";
+    };
+
+    jules::tests::test("append std::vector",
+        [&]
+        {
+            std::vector<int> range = { 3, 4 };
+            v.append_range(range);
+            dump();
+        },
+            "0 1 2 3 4 ");
+
+    jules::tests::test("append jules::vector",
+        [&]
+        {
+            jules::vector<int> range = { 5, 6, 7 };
+            v.append_range(range);
+            dump();
+        },
+            "0 1 2 3 4 5 6 7 ");
+
+    jules::tests::test("insert pointers in the middle",
+        [&]
+        {
+            int raw[] = { -1, -2 };
+            v.insert(v.begin() + 2, raw, raw + 2);
+            dump();
+        },
+            "0 1 -1 -2 2 3 4 5 6 7 ");
+
+    jules::tests::test("insert list in the middle",
+        [&]
+        {
+            v.insert(v.begin() + 1, { 9, 9 });
+            dump();
+        },
+            "0 9 9 1 -1 -2 2 3 4 5 6 7 ");
+
+    jules::tests::test("insert range from itself",
+        [&]
+        {
+            v.resize(3);
+            v.insert_range(v.begin() + 1, v);
+            dump();
+        },
+            "0 0 9 9 9 9 ");
+
+    jules::tests::test("insert_range non contiguous",
+        [&]
+        {
+            jules::vector<std::string> strings = { "a", "d" };
+            std::deque<std::string> range = { "b", "c" };
+            strings.insert_range(strings.begin() + 1, range);
+            for (auto const& s : strings)
+                std::cout << s;
+        },
+            "abcd");
+
+    jules::tests::test("append_range std::list",
+        [&]
+        {
+            // bidirectional iterators have no operator<
+            std::list<int> range = { 7, 8, 9 };
+            v.append_range(range);
+            v.insert(v.begin(), range.begin(), range.begin());
+            dump();
+        },
+            "0 0 9 9 9 9 7 8 9 ");
+
+    jules::tests::test("insert from input iterators",
+        [&]
+        {
+            std::istringstream input("1 2 3");
+            v.insert(v.begin() + 2, std::istream_iterator<int>(input), std::istream_iterator<int>());
+            dump();
+
+            std::istringstream bits_input("1 0 1");
+            jules::vector<bool> bits = { false, false };
+            bits.insert(bits.begin() + 1, std::istream_iterator<int>(bits_input), std::istream_iterator<int>());
+            for (bool bit : bits)
+                std::cout << bit;
+        },
+            "0 0 1 2 3 9 9 9 9 7 8 9 01010");
+
+    jules::tests::test("append many",
+        [&]
+        {
+            std::vector<int> range(10000);
+            for (int i = 0; i != 10000; i++)
+                range[i] = i;
+
+            v.clear();
+            for (int i = 0; i != 10; i++)
+                v.append_range(range);
+
+            std::cout << v.size() << " " << v[54321];
+        },
+            "100000 4321");
+
+    jules::tests::complete();
+}
+
+// true if V v = { size_t, default_init } compiles
+template<class V, typename = void>
+struct copy_list_initializable : std::false_type
+{
+};
+
+template<class V>
+struct copy_list_initializable<V, std::void_t<decltype(std::declval<void (&)(V)>()({ size_t(), jules::default_init }))>> :
+    std::true_type
+{
+};
+
+void for_overwrite()
+{
+    static_assert(!copy_list_initializable<jules::vector<int>>::value,
+        "vector(size_type, default_init_t) must be explicit!");
+
+    jules::tests::start("for_overwrite");
+
+    // every element is written before it is read, so this stays clean under ASan / MSan
+    jules::tests::test("default_init ctor",
+        [&]
+        {
+            jules::vector<uint8_t> buffer(1 << 16, jules::default_init);
+            std::memset(buffer.data(), 7, buffer.size());
+
+            size_t sum = 0;
+            for (auto x : buffer)
+                sum += x;
+
+            std::cout << buffer.size() << " " << sum;
+        },
+            "65536 458752");
+
+    jules::tests::test("resize_for_overwrite",
+        [&]
+        {
+            jules::vector<float> buffer = { 1, 2 };
+            buffer.resize_for_overwrite(1000);
+            for (size_t i = 2; i != buffer.size(); i++)
+                buffer[i] = i;
+
+            std::cout << buffer.size() << " " << buffer[0] << " " << buffer[1] << " " << buffer[999];
+            buffer.resize_for_overwrite(1);
+            std::cout << " " << buffer.size() << " " << buffer[0];
+        },
+            "1000 1 2 999 1 1");
+
+    jules::tests::test("reserve_and_expose",
+        [&]
+        {
+            jules::vector<uint8_t> buffer;
+            for (int chunk = 0; chunk != 4; chunk++)
+            {
+                auto tail = buffer.reserve_and_expose(3);
+                for (int i = 0; i != 3; i++)
+                    tail[i] = '0' + chunk;
+            }
+
+            for (auto x : buffer)
+                std::cout << x;
+        },
+            "000111222333");
+
+    jules::tests::test("non trivial types are still constructed",
+        [&]
+        {
+            jules::vector<std::string> strings(2, jules::default_init);
+            strings.resize_for_overwrite(3);
+            *strings.reserve_and_expose(1) = "x";
+            for (auto const& s : strings)
+                std::cout << "[" << s << "]";
+        },
+            "[][][][x]");
+
+    jules::tests::complete();
+}
+
+// allocate / deallocate only, no extensions
+template<typename T, bool raw_memory = true>
+struct plain_allocator
+{
+    static bool const is_empty = false;
+    static bool const is_raw   = raw_memory;
+    using value_type           = T;
+    using size_type            = std::size_t;
+    using difference_type      = std::ptrdiff_t;
+
+    static size_t allocations;
+
+    [[nodiscard]] T* allocate(size_t n)
+    {
+        allocations++;
+        return static_cast<T*>(std::malloc(n * sizeof(T) + 1));
+    }
+
+    void deallocate(T* ptr, size_t)
+    {
+        std::free(ptr);
+    }
+};
+
+template<typename T, bool raw_memory>
+size_t plain_allocator<T, raw_memory>::allocations = 0;
+
+// every block has room for 64 elements
+template<typename T, bool raw_memory = true>
+struct roomy_allocator : plain_allocator<T, raw_memory>
+{
+    jules::allocator::allocation_result<T> allocate_at_least(size_t n)
+    {
+        n = std::max(n, static_cast<size_t>(64));
+        return { plain_allocator<T, raw_memory>::allocate(n), n };
+    }
+
+    bool try_expand_in_place(T*, size_t, size_t new_n)
+    {
+        return new_n <= 64;
+    }
+};
+
+// resizes blocks with realloc, counts how often
+template<typename T, bool raw_memory = true>
+struct realloc_allocator : plain_allocator<T, raw_memory>
+{
+    static size_t reallocations;
+
+    jules::allocator::allocation_result<T> reallocate(T* ptr, size_t, size_t new_n)
+    {
+        reallocations++;
+        return { static_cast<T*>(std::realloc(ptr, new_n * sizeof(T))), new_n };
+    }
+};
+
+template<typename T, bool raw_memory>
+size_t realloc_allocator<T, raw_memory>::reallocations = 0;
+
+void allocator_protocol()
+{
+    jules::tests::start("allocator_protocol");
+
+    jules::tests::test("Default reports real capacity",
+        [&]
+        {
+            jules::allocator::Default<int, true> allocator;
+            auto block = allocator.allocate_at_least(5);
+            std::cout << (block.count >= 5) << (block.ptr != nullptr);
+            for (int i = 0; i != 5; i++)
+                block.ptr[i] = i;
+
+            // realloc keeps the bytes wherever the block ends up
+            block = allocator.reallocate(block.ptr, block.count, 100000);
+            std::cout << (block.count >= 100000) << block.ptr[4];
+            allocator.deallocate(block.ptr, block.count);
+        },
+            "1114");
+
+    jules::tests::test("traits fall back to allocate",
+        [&]
+        {
+            plain_allocator<int> allocator;
+            using traits = jules::allocator::traits<plain_allocator<int>>;
+            auto block = traits::allocate_at_least(allocator, 5);
+            std::cout << block.count << traits::try_expand_in_place(allocator, block.ptr, 5, 6);
+            allocator.deallocate(block.ptr, block.count);
+        },
+            "50");
+
+    jules::tests::test("vector uses allocate_at_least",
+        [&]
+        {
+            plain_allocator<int>::allocations = 0;
+            jules::vector<int, roomy_allocator<int>> v;
+            v.reserve(3);
+            std::cout << v.capacity() << " ";
+            v.reserve(10);
+            v.reserve(64);
+            for (int i = 0; i != 64; i++)
+                v.push_back(i);
+
+            std::cout << plain_allocator<int>::allocations << " " << v[63];
+        },
+            "64 1 63");
+
+    jules::tests::test("vector grows through reallocate",
+        [&]
+        {
+            using allocator = realloc_allocator<int>;
+            allocator::allocations = allocator::reallocations = 0;
+            {
+                jules::vector<int, allocator> v;
+                for (int i = 0; i != 1000; i++)
+                    v.push_back(i);
+
+                v.resize(10);
+                v.shrink_to_fit();
+                std::cout << allocator::allocations << " " << allocator::reallocations << " " << v[9] << " ";
+            }
+
+            // elements that aren`t trivially relocatable are moved one by one
+            using string_allocator = realloc_allocator<std::string>;
+            jules::vector<std::string, string_allocator> strings;
+            for (int i = 0; i != 100; i++)
+                strings.push_back(std::to_string(i));
+
+            std::cout << string_allocator::reallocations << " " << strings[99];
+        },
+            "1 9 9 0 99");
+
+    jules::tests::test("vector without extensions",
+        [&]
+        {
+            plain_allocator<int>::allocations = 0;
+            jules::vector<int, plain_allocator<int>> v;
+            v.reserve(3);
+            std::cout << v.capacity() << " ";
+            v.reserve(10);
+            std::cout << v.capacity() << " " << plain_allocator<int>::allocations;
+        },
+            "3 10 3");
+
+    jules::tests::complete();
+}
+
+void mmap_storage()
+{
+    jules::tests::start("mmap_storage");
+
+    using mmap_vector = jules::vector<long, jules::allocator::Default<long, true>, jules::storage::on_mmap>;
+    mmap_vector v;
+
+    jules::tests::test("empty has no mapping",
+        [&]
+        {
+            std::cout << v.capacity() << " " << (v.data() == nullptr);
+        },
+            "0 1");
+
+    jules::tests::test("grows by remapping",
+        [&]
+        {
+            for (long i = 0; i != 1 << 20; i++)
+                v.push_back(i);
+
+            long sum = 0;
+            for (auto x : v)
+                sum += x;
+
+            std::cout << v.size() << " " << sum << " ";
+            std::cout << (reinterpret_cast<uintptr_t>(v.data()) % 4096) << " " << (v.capacity() * sizeof(long)) % 4096;
+        },
+            "1048576 549755289600 0 0");
+
+    jules::tests::test("shrinks by remapping",
+        [&]
+        {
+            v.resize(10);
+            v.shrink_to_fit();
+            std::cout << v.capacity() * sizeof(long) << " " << v[9];
+        },
+            "4096 9");
+
+    jules::tests::test("move steals mapping",
+        [&]
+        {
+            auto data = v.data();
+            mmap_vector mv = std::move(v);
+            std::cout << (mv.data() == data) << " " << v.capacity() << " " << mv[9];
+        },
+            "1 0 9");
+
+    jules::tests::complete();
+}
+
+void bool_words()
+{
+    jules::tests::start("bool_words");
+
+    jules::vector<bool> v(100, true);
+
+    jules::tests::test("filled by words, tail is zero",
+        [&]
+        {
+            std::cout << v.word_count() << " " << int(v.data()[0]) << " " << int(v.data()[12]) << " "
+                      << (v.word_data()[1] == (uint64_t(1) << 36) - 1);
+        },
+            "2 255 15 1");
+
+    jules::tests::test("resize with value",
+        [&]
+        {
+            v.resize(70);
+            v.resize(130, false);
+            v.resize(140, true);
+            std::cout << v[69] << v[70] << v[129] << v[130] << v[139] << " " << v.word_count();
+        },
+            "10011 3");
+
+    jules::tests::test("compare",
+        [&]
+        {
+            jules::vector<bool> a = { true, false, true };
+            jules::vector<bool> b(3, true);
+            b[1] = false;
+            auto c = b;
+            c.push_back(true);
+            std::cout << (a == b) << (a == c);
+            c.pop_back();
+            std::cout << (a == c) << (a != jules::vector<bool>(3));
+        },
+            "1011");
+
+    jules::tests::test("fill, flip, assign",
+        [&]
+        {
+            v.fill(true);
+            v.flip();
+            std::cout << (v == jules::vector<bool>(140)) << " ";
+            v.assign(65, true);
+            std::cout << v.size() << " " << (v.word_data()[1] == 1);
+        },
+            "1 65 1");
+
+    jules::tests::test("insert / erase keep tail zero",
+        [&]
+        {
+            jules::vector<bool> w(64, true);
+            w.insert(w.begin(), false);
+            w.erase(w.begin() + 60, w.end());
+            std::cout << w.size() << " " << (w.word_data()[0] == ((uint64_t(1) << 60) - 2));
+        },
+            "60 1");
+
+    jules::tests::complete();
+}
+
+void bool_bit_queries()
+{
+    jules::tests::start("bool_bit_queries");
+
+    jules::vector<bool> v(2000);
+
+    jules::tests::test("nothing set",
+        [&]
+        {
+            std::cout << v.count() << " " << v.any() << v.none() << " " << v.find_first() << " "
+                      << jules::vector<bool>().find_first();
+        },
+            "0 01 2000 0");
+
+    jules::tests::test("count and find across blocks",
+        [&]
+        {
+            v[0] = v[255] = v[256] = v[1500] = v[1999] = true;
+            std::cout << v.count() << " " << v.find_first() << " " << v.find_next(1) << " "
+                      << v.find_next(257) << " " << v.find_next(1501) << " " << v.find_next(5000);
+        },
+            "5 0 255 1500 1999 2000");
+
+    jules::tests::test("every set bit",
+        [&]
+        {
+            for (auto i = v.find_first(); i != v.size(); i = v.find_next(i + 1))
+                std::cout << i << " ";
+        },
+            "0 255 256 1500 1999 ");
+
+    jules::tests::test("clear bits",
+        [&]
+        {
+            v.fill(true);
+            v[1234] = false;
+            std::cout << v.find_first_clear() << " " << v.find_next_clear(1235) << " " << v.count();
+            v.push_back(false);
+            std::cout << " " << v.find_next_clear(1235);
+        },
+            "1234 2000 1999 2000");
+
+    jules::tests::complete();
+}
+
+template<typename Bits>
+static void print_bits_(Bits const& bits)
+{
+    for (size_t i = 0; i != bits.size(); i++)
+        std::cout << bits[i];
+}
+
+void bool_bitwise()
+{
+    jules::tests::start("bool_bitwise");
+
+    jules::vector<bool> a = { 1, 1, 0, 0, 1 };
+    jules::vector<bool> b = { 1, 0, 1 };
+
+    jules::tests::test("shorter operand is zero-extended",
+        [&]
+        {
+            print_bits_(a & b);
+            std::cout << " ";
+            print_bits_(b | a);
+            std::cout << " ";
+            print_bits_(a ^ b);
+            std::cout << " ";
+            print_bits_(andnot(a, b));
+            std::cout << " ";
+            print_bits_(andnot(b, a));
+        },
+            "10000 11101 01101 01001 00100");
+
+    jules::tests::test("not and shifts keep size",
+        [&]
+        {
+            print_bits_(~b);
+            std::cout << " ";
+            print_bits_(a << 2);
+            std::cout << " ";
+            print_bits_(a >> 1);
+            std::cout << " " << (~a).count() << (a << 5).count();
+        },
+            "010 00110 10010 20");
+
+    jules::tests::test("long shifts match per-bit shifts",
+        [&]
+        {
+            jules::vector<bool> v(1000);
+            for (size_t i = 0; i < v.size(); i += 7)
+                v[i] = true;
+
+            bool ok = true;
+            for (size_t shift : { 1, 63, 64, 65, 130, 333, 999, 1000 })
+            {
+                auto up = v << shift;
+                auto down = v >> shift;
+                for (size_t i = 0; i != v.size(); i++)
+                {
+                    ok &= up[i] == (i >= shift && v[i - shift]);
+                    ok &= down[i] == (i + shift < v.size() && v[i + shift]);
+                }
+            }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("in place over many words",
+        [&]
+        {
+            jules::vector<bool> x(700, true), y(650);
+            y[3] = y[649] = true;
+            x &= y;
+            std::cout << x.size() << " " << x.count() << " ";
+            x |= jules::vector<bool>(800, true);
+            x ^= jules::vector<bool>(100, true);
+            x.andnot(jules::vector<bool>(801));
+            std::cout << x.size() << " " << x.count() << " " << x.find_first();
+        },
+            "700 2 801 700 100");
+
+    jules::tests::complete();
+}
+
+void bool_word_shifts()
+{
+    jules::tests::start("bool_word_shifts");
+
+    jules::tests::test("insert / erase match std::vector<bool>",
+        [&]
+        {
+            jules::vector<bool> v;
+            std::vector<bool> model;
+            uint64_t seed = 777;
+            auto next = [&]
+            {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                return static_cast<size_t>(seed >> 33);
+            };
+
+            bool ok = true;
+            for (int round = 0; round != 400; round++)
+            {
+                auto pos = model.empty() ? 0 : next() % (model.size() + 1);
+                auto count = next() % 150;
+                bool value = next() % 2;
+                switch (next() % 4)
+                {
+                case 0:
+                    v.insert(v.begin() + pos, count, value);
+                    model.insert(model.begin() + pos, count, value);
+                    break;
+
+                case 1:
+                    v.insert(v.begin() + pos, value);
+                    model.insert(model.begin() + pos, value);
+                    break;
+
+                default:
+                    count = std::min(count, model.size() - pos);
+                    v.erase(v.begin() + pos, v.begin() + pos + count);
+                    model.erase(model.begin() + pos, model.begin() + pos + count);
+                    break;
+                }
+
+                ok &= v.size() == model.size();
+                for (size_t i = 0; ok && i != model.size(); i++)
+                    ok &= v[i] == model[i];
+
+                // tail stays zero
+                if (v.word_count() != 0)
+                    ok &= (v.word_data()[v.word_count() - 1] & ~jules::bits::tail_mask(v.size())) == 0;
+            }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("front insert / erase keeps order",
+        [&]
+        {
+            jules::vector<bool> v(1000);
+            for (size_t i = 0; i < v.size(); i += 10)
+                v[i] = true;
+
+            v.insert(v.begin(), 3, true);
+            v.erase(v.begin() + 1, v.begin() + 3);
+            std::cout << v.size() << " " << v.count() << " " << v.find_next(1) << " " << v.find_next(2);
+        },
+            "1001 101 1 11");
+
+    jules::tests::complete();
+}
+
+void bool_set_bits()
+{
+    jules::tests::start("bool_set_bits");
+
+    jules::vector<bool> v(1100);
+    for (size_t i : { 0, 1, 2, 3, 4, 63, 64, 500, 1023, 1099 })
+        v[i] = true;
+
+    jules::tests::test("for_each_set_bit",
+        [&]
+        {
+            v.for_each_set_bit([](size_t i) { std::cout << i << " "; });
+        },
+            "0 1 2 3 4 63 64 500 1023 1099 ");
+
+    jules::tests::test("sparse and dense variants agree",
+        [&]
+        {
+            v.for_each_set_bit_sparse([](size_t i) { std::cout << i << " "; });
+            v.for_each_set_bit_dense([](size_t i) { std::cout << i << " "; });
+        },
+            "0 1 2 3 4 63 64 500 1023 1099 "
+            "0 1 2 3 4 63 64 500 1023 1099 ");
+
+    jules::tests::test("set bit range",
+        [&]
+        {
+            for (auto i : v.set_bits())
+                std::cout << i << " ";
+
+            jules::vector<bool> zeros(300), empty;
+            std::cout << (zeros.set_bits().begin() == zeros.set_bits().end()) << " "
+                      << (empty.set_bits().begin() == empty.set_bits().end());
+        },
+            "0 1 2 3 4 63 64 500 1023 1099 1 1");
+
+    jules::tests::test("all set",
+        [&]
+        {
+            jules::vector<bool> all(130, true);
+            size_t sum = 0, visited = 0;
+            all.for_each_set_bit_dense([&](size_t i) { sum += i; visited++; });
+            for (auto i : all.set_bits())
+                sum -= i;
+            std::cout << visited << " " << sum;
+        },
+            "130 0");
+
+    jules::tests::complete();
+}
+
+// bits.hpp kernels against bit by bit models, at every length around the
+// 4 word (AVX2) and 8 bit (BMI2 select) steps; run by the *_simd_dbg
+// targets too, where the SIMD branches are compiled in
+void bit_kernels()
+{
+    namespace bits = jules::bits;
+    jules::tests::start("bit_kernels");
+
+    uint64_t seed = 12345;
+    auto random_word = [&]
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        auto word = seed ^ (seed >> 29);
+
+        // sparse, dense and mixed words
+        switch ((seed >> 61) & 3)
+        {
+            case 0:  return word & (word >> 7) & (word >> 13);
+            case 1:  return word | (word << 5) | (word << 11);
+            default: return word;
+        }
+    };
+
+    auto random_words = [&](size_t n)
+    {
+        std::vector<uint64_t> words(n + 1);
+        for (auto& word : words)
+            word = random_word();
+        return words;
+    };
+
+    auto bit = [](std::vector<uint64_t> const& words, size_t i)
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    };
+
+    jules::tests::test("count / find / any / none / all",
+        [&]
+        {
+            bool ok = true;
+            for (size_t size = 0; size <= 64 * 21; size += 1 + size % 13)
+            {
+                auto words = random_words(bits::words_number(size));
+                if (size % 5 == 0)
+                    for (auto& word : words)
+                        word = ~uint64_t(0);
+
+                size_t count = 0;
+                for (size_t i = 0; i != size; i++)
+                    count += bit(words, i);
+
+                ok &= bits::count(words.data(), size) == count;
+                ok &= bits::any(words.data(), size) == (count != 0);
+                ok &= bits::none(words.data(), size) == (count == 0);
+                ok &= bits::all(words.data(), size) == (count == size);
+
+                for (size_t pos = 0; pos <= size; pos += 1 + pos % 7)
+                {
+                    size_t next = pos, next_clear = pos;
+                    while (next < size && !bit(words, next))
+                        next++;
+                    while (next_clear < size && bit(words, next_clear))
+                        next_clear++;
+
+                    ok &= bits::find_next(words.data(), size, pos) == next;
+                    ok &= bits::find_next_clear(words.data(), size, pos) == next_clear;
+                }
+            }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("select_in_word",
+        [&]
+        {
+            bool ok = true;
+            for (size_t round = 0; round != 2000; round++)
+            {
+                auto word = random_word();
+                for (size_t i = 0, k = 0; i != 64; i++)
+                    if ((word >> i) & 1)
+                        ok &= bits::select_in_word(word, k++) == i;
+            }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("combine / invert",
+        [&]
+        {
+            bool ok = true;
+            for (size_t dst_words = 0; dst_words != 21; dst_words++)
+                for (size_t src_words = 0; src_words <= dst_words; src_words++)
+                {
+                    auto dst = random_words(dst_words), src = random_words(src_words);
+                    auto a = dst, o = dst, x = dst, n = dst, inverted = dst;
+                    bits::combine<bits::op_and>(a.data(), src.data(), src_words, dst_words);
+                    bits::combine<bits::op_or>(o.data(), src.data(), src_words, dst_words);
+                    bits::combine<bits::op_xor>(x.data(), src.data(), src_words, dst_words);
+                    bits::combine<bits::op_andnot>(n.data(), src.data(), src_words, dst_words);
+                    bits::invert(inverted.data(), dst_words);
+
+                    for (size_t i = 0; i != dst_words; i++)
+                    {
+                        auto s = i < src_words ? src[i] : 0;
+                        ok &= a[i] == (dst[i] & s) && o[i] == (dst[i] | s) && x[i] == (dst[i] ^ s) &&
+                              n[i] == (dst[i] & ~s) && inverted[i] == ~dst[i];
+                    }
+
+                    // one word past dst_words is never written
+                    ok &= a[dst_words] == dst[dst_words] && inverted[dst_words] == dst[dst_words];
+                }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("shift_up / shift_down",
+        [&]
+        {
+            bool ok = true;
+            for (size_t n = 1; n != 14; n++)
+                for (size_t shift = 0; shift <= 64 * n + 3; shift += 1 + shift % 11)
+                {
+                    auto words = random_words(n);
+                    auto up = words, down = words;
+                    bits::shift_up(up.data(), n, shift);
+                    bits::shift_down(down.data(), n, shift);
+
+                    for (size_t i = 0; i != 64 * n; i++)
+                    {
+                        ok &= bit(up, i) == (i >= shift ? bit(words, i - shift) : 0);
+                        ok &= bit(down, i) == (i + shift < 64 * n ? bit(words, i + shift) : 0);
+                    }
+                }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("set bit visits",
+        [&]
+        {
+            bool ok = true;
+            for (size_t size = 0; size <= 64 * 21; size += 1 + size % 17)
+            {
+                auto words = random_words(bits::words_number(size));
+                std::vector<size_t> model, plain, sparse, dense;
+                for (size_t i = 0; i != size; i++)
+                    if (bit(words, i))
+                        model.push_back(i);
+
+                bits::for_each_set(words.data(), size, [&](size_t i) { plain.push_back(i); });
+                bits::for_each_set_sparse(words.data(), size, [&](size_t i) { sparse.push_back(i); });
+                bits::for_each_set_dense(words.data(), size, [&](size_t i) { dense.push_back(i); });
+                ok &= plain == model && sparse == model && dense == model;
+            }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::complete();
+}
+
+void rank_select()
+{
+    jules::tests::start("rank_select");
+
+    // dense start, sparse middle, empty and full stretches
+    jules::vector<bool> v(300000);
+    uint64_t seed = 12345;
+    for (size_t i = 0; i != v.size(); i++)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        auto r = seed >> 33;
+        if (i < 100000)
+            v[i] = r % 2;
+        else if (i < 200000)
+            v[i] = r % 1000 == 0;
+        else if (i >= 250000)
+            v[i] = true;
+    }
+
+    jules::rank_select index(v);
+
+    jules::tests::test("rank matches prefix counts",
+        [&]
+        {
+            bool ok = true;
+            size_t ones = 0;
+            for (size_t i = 0; i != v.size(); i++)
+            {
+                if (i % 97 == 0 || i % 512 == 0)
+                    ok &= index.rank(i) == ones;
+                ones += v[i];
+            }
+
+            ok &= index.rank(v.size()) == ones && index.ones() == ones;
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("select inverts rank",
+        [&]
+        {
+            bool ok = true;
+            size_t k = 0;
+            for (auto i = v.find_first(); i != v.size(); i = v.find_next(i + 1), k++)
+                ok &= index.select(k) == i;
+
+            std::cout << ok << " " << (index.select(k) == v.size());
+        },
+            "1 1");
+
+    jules::tests::test("overhead is a few percent",
+        [&]
+        {
+            auto percent = 100.0 * index.overhead() / (v.size() / 8);
+            std::cout << (percent > 3 && percent < 6);
+        },
+            "1");
+
+    jules::tests::test("rebuild after mutation",
+        [&]
+        {
+            v.resize(1000);
+            std::cout << index.is_built_for(v) << " ";
+            v.fill(false);
+            v[10] = v[999] = true;
+            index.rebuild(v);
+            std::cout << index.is_built_for(v) << " " << index.rank(500) << index.rank(1000) << " "
+                      << index.select(1) << " " << jules::rank_select(jules::vector<bool>()).select(0);
+        },
+            "0 1 12 999 0");
+
+    jules::tests::test("changes make the index stale",
+        [&]
+        {
+            std::cout << index.is_fresh() << index.rank(11) << " ";
+            v.word_data()[7] |= 1;
+            std::cout << index.is_fresh() << index.is_built_for(v) << " ";
+            index.rebuild(v);
+            std::cout << index.is_fresh() << index.rank(1000) << " ";
+
+            v.reserve(1 << 20);
+            std::cout << index.is_fresh();
+            index.rebuild(v);
+            v.shrink_to_fit();
+            std::cout << index.is_fresh();
+            index.rebuild(v);
+            v.pop_back();
+            std::cout << index.is_fresh() << " ";
+
+            // outlives the container, or the container is moved from
+            jules::rank_select dead;
+            {
+                jules::vector<bool> w(100, true);
+                dead.rebuild(w);
+                std::cout << dead.is_fresh();
+            }
+            std::cout << dead.is_fresh();
+            index.rebuild(v);
+            auto moved = std::move(v);
+            std::cout << index.is_fresh() << index.is_built_for(moved) << " ";
+            v = std::move(moved);
+            v.push_back(false);
+
+            jules::array<bool, 256, jules::storage::on_stack> a(256);
+            jules::rank_select words_index(a);
+            a.word_data()[0] |= 1 << 7;
+            std::cout << words_index.is_built_for(a) << " ";
+            words_index.rebuild(a);
+            std::cout << words_index.is_built_for(a) << words_index.select(0);
+        },
+            "11 00 13 000 1000 0 17");
+
+#ifdef JULES_CHECKED_ITERATORS
+    jules::tests::test_exception("stale index throws",
+        [&]
+        {
+            index.rebuild(v);
+            v.reserve(1 << 22);
+            (void) index.rank(1000);
+        });
+#endif
+
+    jules::tests::complete();
+}
+
+void roaring()
+{
+    jules::tests::start("roaring");
+
+    // sparse chunk, random chunk, long runs, empty chunk, short last chunk
+    jules::vector<bool> v(4 * 65536 + 1000);
+    uint64_t seed = 777;
+    for (size_t i = 0; i != v.size(); i++)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        auto r = seed >> 33;
+        if (i < 65536)
+            v[i] = r % 100 == 0;
+        else if (i < 2 * 65536)
+            v[i] = r % 2;
+        else if (i < 3 * 65536)
+            v[i] = i % 10000 < 5000;
+        else if (i >= 4 * 65536)
+            v[i] = i % 3 == 0;
+    }
+
+    jules::roaring_bitmap r(v);
+
+    jules::tests::test_exception("bounds checked",
+        [&]
+        {
+            r[r.size()] = true;
+        });
+
+    jules::tests::test("chunk kinds and round trip",
+        [&]
+        {
+            std::cout << r.chunks() << " ";
+            for (size_t i = 0; i != r.chunks(); i++)
+                std::cout << int(r.chunk_kind(i));
+
+            std::cout << " " << (r.size() == v.size()) << (r.count() == v.count())
+                      << (r.to_vector() == v) << (r.memory() < v.word_count() * 8);
+        },
+            "4 0120 1111");
+
+    jules::tests::test("searches and visits match vector<bool>",
+        [&]
+        {
+            bool ok = true;
+            auto j = r.find_first();
+            for (auto i = v.find_first(); i != v.size(); i = v.find_next(i + 1), j = r.find_next(j + 1))
+                ok &= i == j && r[i];
+
+            ok &= j == r.size() && r.find_next(r.size()) == r.size();
+
+            size_t visited = 0;
+            r.for_each_set_bit([&](size_t i) { ok &= v[i]; visited++; });
+            std::cout << ok << (visited == v.count());
+        },
+            "11");
+
+    jules::tests::test("set and reset change kinds",
+        [&]
+        {
+            jules::roaring_bitmap s(200000);
+            for (size_t i = 0; i != 4096; i++)
+                s[2 * i] = true;
+
+            std::cout << int(s.chunk_kind(0));
+            s.set(1);
+            std::cout << int(s.chunk_kind(0));
+            s.reset(0);
+            s[2] = false;
+            std::cout << int(s.chunk_kind(0)) << " " << s.count() << " ";
+
+            // run chunks turn back into arrays / bitmaps when written
+            auto t = r;
+            t.reset(2 * 65536);
+            t.set(2 * 65536 + 7000);
+            std::cout << int(t.chunk_kind(2)) << (t.count() == r.count()) << (t != r) << " ";
+
+            t.optimize();
+            t.reset(2 * 65536 + 7000);
+            t.set(2 * 65536);
+            t.optimize();
+            std::cout << int(t.chunk_kind(2)) << (t == r);
+        },
+            "010 4095 111 21");
+
+    jules::tests::test("union and intersection match vector<bool>",
+        [&]
+        {
+            jules::vector<bool> w(3 * 65536 + 123);
+            for (size_t i = 0; i != w.size(); i++)
+                w[i] = (i % 7 == 0) || (i > 65536 && i % 2 == 0);
+
+            jules::roaring_bitmap q(w);
+            auto both = r & q;
+            auto either = r | q;
+
+            std::cout << ((both.to_vector() == (v & w)) && (either.to_vector() == (v | w))) << " "
+                      << both.size() << " " << (either.count() == (v | w).count()) << " ";
+
+            q &= jules::roaring_bitmap(w.size());
+            std::cout << q.none() << q.size();
+        },
+            "1 263144 1 1196731");
+
+    jules::tests::test("in place union and intersection",
+        [&]
+        {
+            // chunk 0: arrays of close sizes, 1: skewed arrays, 2: array and
+            // bitmap, 3: arrays overflowing into a bitmap, 5: only in x
+            jules::vector<bool> x(6 * 65536), y(5 * 65536);
+            uint64_t seed = 99;
+            for (size_t i = 0; i != x.size(); i++)
+            {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                auto r = seed >> 33;
+                if (i < 65536)
+                {
+                    x[i] = r % 40 == 0;
+                    y[i] = (r >> 8) % 50 == 0;
+                }
+                else if (i < 2 * 65536)
+                {
+                    x[i] = r % 20 == 0;
+                    y[i] = i % 3000 == 0;
+                }
+                else if (i < 3 * 65536)
+                {
+                    x[i] = r % 50 == 0;
+                    y[i] = r % 3 != 0;
+                }
+                else if (i < 4 * 65536)
+                {
+                    x[i] = r % 20 == 0;
+                    y[i] = (r >> 8) % 22 == 0;
+                }
+                else if (i >= 5 * 65536)
+                    x[i] = r % 40 == 0;
+            }
+
+            jules::roaring_bitmap a(x), b(y);
+            auto both = a & b;
+            auto either = a | b;
+
+            auto c = a, d = a, e = b;
+            c &= b;
+            d |= b;
+            e |= a;
+            std::cout << (c == both) << (d == either) << (e == either) << (c.to_vector() == (x & y))
+                      << (d.to_vector() == (x | y)) << " " << c.chunks() << d.chunks() << " ";
+
+            c &= c;
+            d |= d;
+            std::cout << (c == both) << (d == either);
+        },
+            "11111 45 11");
+
+    jules::tests::test("resize and push_back",
+        [&]
+        {
+            auto t = r;
+            t.resize(65536 + 10);
+            auto u = v;
+            u.resize(65536 + 10);
+            std::cout << (t.to_vector() == u) << t.chunks() << " ";
+
+            t.resize(65536);
+            t.push_back(true);
+            std::cout << t.chunks() << t.size() << t[65536] << " ";
+
+            t.clear();
+            std::cout << t.empty() << t.any();
+        },
+            "12 2655371 10");
+
+    jules::tests::complete();
+}
+
+// push_back, random access and both bulk paths against plain uint32_t
+template<size_t Bits>
+static bool packed_matches_()
+{
+    jules::vector<uint32_t> values;
+    jules::packed_vector<Bits> v;
+    uint64_t seed = Bits;
+    for (size_t i = 0; i != 1003; i++)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        values.push_back(static_cast<uint32_t>(seed >> 32) & jules::packed_vector<Bits>::max_value);
+        v.push_back(values.back());
+    }
+
+    bool ok = v.size() == values.size();
+    for (size_t i = 0; i != values.size(); i++)
+        ok &= v[i] == values[i];
+
+    // odd offsets exercise the scalar head and tail around whole groups
+    jules::vector<uint32_t> out(values.size());
+    v.unpack(5, 990, out.data());
+    for (size_t i = 0; i != 990; i++)
+        ok &= out[i] == values[i + 5];
+
+    jules::packed_vector<Bits> packed(values.data(), 3);
+    packed.append(values.data() + 3, values.size() - 3);
+    auto unpacked = v.unpack();
+    ok &= packed == v && unpacked.size() == values.size() &&
+          std::equal(unpacked.data(), unpacked.data() + unpacked.size(), values.data());
+    return ok;
+}
+
+void packed_vector()
+{
+    jules::tests::start("packed_vector");
+    jules::packed_vector<12> v(5, 7);
+
+    jules::tests::test_exception("bounds checked",
+        [&]
+        {
+            v[5] = 0;
+        });
+
+    jules::tests::test("fill, truncation, straddling writes",
+        [&]
+        {
+            v[1] = 4095;
+            v[2] = 4096 + 3;
+            for (size_t i = 0; i != v.size(); i++)
+                std::cout << v[i] << " ";
+
+            // elements 5 and 10 cross word boundaries
+            v.resize(12, 1);
+            v[5] = 0xABC;
+            v[10] = 0x123;
+            std::cout << std::hex << v[5] << " " << v[10] << " " << v[4] << v[6] << v[11] << std::dec << " "
+                      << v.word_count() << " " << (v.capacity() >= v.size());
+        },
+            "7 4095 3 7 7 abc 123 711 3 1");
+
+    jules::tests::test("pop_back keeps the tail clear",
+        [&]
+        {
+            auto w = v;
+            w.pop_back();
+            w.pop_back();
+            w.push_back(1);
+            w.push_back(1);
+            v[10] = 1;
+            std::cout << (w == v) << " ";
+
+            w.resize(3);
+            w.resize(12);
+            std::cout << w[3] << w[11] << " " << w.size();
+        },
+            "1 00 12");
+
+    jules::tests::test("widths 1..32 match uint32_t",
+        [&]
+        {
+            std::cout << packed_matches_<1>() << packed_matches_<3>() << packed_matches_<7>()
+                      << packed_matches_<12>() << packed_matches_<17>() << packed_matches_<20>()
+                      << packed_matches_<25>() << packed_matches_<26>() << packed_matches_<31>()
+                      << packed_matches_<32>();
+        },
+            "1111111111");
+
+    jules::tests::test("move and swap",
+        [&]
+        {
+            jules::packed_vector<5> a{1, 2, 3}, b{31, 30};
+            a.swap(b);
+            auto c = std::move(a);
+            std::cout << a.size() << " " << c[0] << c[1] << " " << b.size() << b[2];
+        },
+            "0 3130 33");
+
+    jules::tests::test("size / value and pointer / count constructors",
+        [&]
+        {
+            uint32_t values[] = { 4, 5, 6 };
+            jules::packed_vector<5> empty(0, 5), filled(2, 5), copied(values, 3);
+            std::cout << empty.size() << " " << filled[0] << filled[1] << " " << copied[2] << copied.size();
+        },
+            "0 55 63");
+
+    jules::tests::complete();
+}
+
+void bit_span()
+{
+    jules::tests::start("bit_span");
+
+    jules::vector<bool> v(1000);
+    for (size_t i = 0; i != v.size(); i++)
+        v[i] = (i % 3 == 0) || (i > 600 && i < 700);
+
+    jules::tests::test_exception("bounds checked",
+        [&]
+        {
+            jules::bit_span(v, 900, 101);
+        });
+
+    jules::tests::test("queries over odd offsets match the vector",
+        [&]
+        {
+            bool ok = true;
+            for (size_t first : {0, 1, 7, 8, 63, 64, 65, 333})
+            {
+                jules::const_bit_span span(static_cast<jules::vector<bool> const&>(v), first, 1000 - first - 5);
+                size_t count = 0;
+                for (size_t i = 0; i != span.size(); i++)
+                {
+                    ok &= span[i] == v[first + i];
+                    count += v[first + i];
+                }
+
+                ok &= span.count() == count;
+                ok &= span.find_first() + first == v.find_next(first);
+                ok &= span.find_next(610 - first) + first == 610;
+                ok &= span.find_next_clear(610 - first) + first == 700;
+
+                size_t visited = 0;
+                span.for_each_set_bit([&](size_t i) { ok &= v[first + i]; visited++; });
+                ok &= visited == count;
+            }
+
+            std::cout << ok;
+        },
+            "1");
+
+    jules::tests::test("writes stay inside the span",
+        [&]
+        {
+            auto w = v;
+            jules::bit_span span(w, 67, 130);
+            span.fill(true);
+            span.set(0, false);
+            std::cout << w[66] << w[67] << w[68] << w[196] << w[197] << " " << w.count() - v.count() << " ";
+
+            span.flip();
+            std::cout << span.count() << w[67] << " ";
+
+            jules::const_bit_span other(v, 300, 130);
+            span.assign(other);
+            std::cout << (span == other) << (span.subspan(3, 60) == other.subspan(3, 60)) << (span != other.subspan(0, 129));
+        },
+            "10110 86 11 111");
+
+    jules::tests::test("bitwise between spans",
+        [&]
+        {
+            auto w = v;
+            jules::bit_span low(w, 0, 500), high(w, 500, 500);
+            jules::const_bit_span steps(v, 1, 300);
+
+            // aligned with aligned: whole words go through combine
+            low &= jules::const_bit_span(v, 500, 500);
+            std::cout << low.count() << " ";
+
+            high |= steps;
+            high ^= steps;
+            std::cout << high.count() << " " << (jules::const_bit_span(w, 800, 200) == jules::const_bit_span(v, 800, 200)) << " ";
+
+            high.andnot(jules::const_bit_span(v, 0, 500));
+            std::cout << high.count() << " " << high.none() << high.all();
+        },
+            "33 200 1 167 00");
+
+    jules::tests::test("raw unaligned buffers",
+        [&]
+        {
+            // 13 bytes, no padding: the span must not read past them
+            auto raw = new uint8_t[13];
+            std::memset(raw, 0xF0, 13);
+
+            jules::bit_span span(raw + 1, 90, 3);
+            std::cout << span.count() << " " << span.find_first() << " " << span.find_first_clear() << " ";
+
+            span.fill(false);
+            std::cout << std::hex << int(raw[1]) << int(raw[12]) << std::dec << " " << span.none();
+            delete[] raw;
+        },
+            "45 1 0 0e0 1");
+
+    jules::tests::test("raw aligned buffers go word by word",
+        [&]
+        {
+            // 8-byte aligned bytes are still not words, only loads read them
+            alignas(8) uint8_t raw[24] = {};
+            raw[0] = 0x01;
+            raw[9] = 0x80;
+            raw[23] = 0x40;
+
+            jules::bit_span span(raw, 192);
+            std::cout << span.count() << " " << span.find_first() << " " << span.find_next(1) << " "
+                      << span.find_next(80) << " ";
+
+            span.subspan(64, 128).assign(jules::const_bit_span(v, 64, 128));
+            std::cout << (span.subspan(64, 128) == jules::const_bit_span(v, 64, 128)) << int(raw[0]);
+        },
+            "3 0 79 190 11");
+
+    jules::tests::complete();
+}
+
+void arena()
+{
+    jules::tests::start("arena");
+    using int_vector = jules::vector<int, jules::allocator::Arena<int, true>>;
+
+    jules::tests::test_exception("no arena outside of a scope",
+        [&]
+        {
+            int_vector v;
+            v.push_back(1);
+        });
+
+    jules::allocator::arena arena;
+
+    jules::tests::test("bump allocation and growth in place",
+        [&]
+        {
+            jules::allocator::arena::scope use(arena);
+            int_vector v;
+            for (int i = 0; i != 200; i++)
+                v.push_back(i);
+
+            // the newest block kept growing, nothing was left behind
+            auto first = v.data();
+            std::cout << v[199] << " " << arena.used() << " " << (arena.used() == v.capacity() * sizeof(int)) << " ";
+
+            // not the newest any more: moves out, the old block stays used
+            int_vector w(10);
+            for (int i = 0; i != 100; i++)
+                v.push_back(i);
+
+            std::cout << (v.data() != first) << w.size() << " " << arena.used() << " " << arena.reserved();
+        },
+            "199 1024 1 110 3112 65536");
+
+    jules::tests::test("bool containers and arrays rebind",
+        [&]
+        {
+            jules::allocator::arena::scope use(arena);
+            auto before = arena.used();
+
+            jules::vector<bool, jules::allocator::Arena<bool, true>> bits(1000, true);
+            jules::array<bool, 640, jules::storage::on_heap, jules::allocator::Arena<bool, true>> fixed(640);
+            jules::array<long, 8, jules::storage::on_heap, jules::allocator::Arena<long, true>> longs(8);
+            fixed[639] = true;
+            longs[7] = 7;
+
+            std::cout << bits.count() << " " << fixed.count() << longs[7] << " " << arena.used() - before;
+        },
+            "1000 17 272");
+
+    jules::tests::test("moves and swaps carry the arena",
+        [&]
+        {
+            using bool_vector = jules::vector<bool, jules::allocator::Arena<bool, true>>;
+            using hybrid_vector = jules::vector<int, jules::allocator::Arena<int, true>,
+                                                jules::storage::hybrid<4>::type>;
+
+            // made outside of any scope, filled inside one, grown outside again
+            jules::allocator::arena first, second;
+            int_vector outside;
+            bool_vector bits;
+            hybrid_vector small;
+            {
+                jules::allocator::arena::scope use(first);
+                outside = int_vector(100, 1);
+                bits = bool_vector(100, true);
+                small = hybrid_vector(100, 3);
+            }
+
+            auto used = first.used();
+            outside.resize(10000);
+            bits.resize(100000, true);
+            small.resize(1000);
+            std::cout << outside[99] << outside[9999] << " " << bits.count() << " " << small[99] << small[999] << " "
+                      << (first.used() - used >= 10000 * sizeof(int) + 100000 / 8 + 1000 * sizeof(int)) << " ";
+
+            // each keeps growing in the arena its block came from
+            int_vector x, y;
+            {
+                jules::allocator::arena::scope use(first);
+                x = int_vector(8, 5);
+            }
+            {
+                jules::allocator::arena::scope use(second);
+                y = int_vector(8, 6);
+            }
+
+            x.swap(y);
+            auto first_used = first.used(), second_used = second.used();
+            x.resize(1000);
+            std::cout << x[0] << y[0] << " " << (first.used() == first_used) << (second.used() > second_used) << " ";
+
+            // inline one swapped with a heap one in an arena
+            hybrid_vector inline_one(2, 7);
+            inline_one.swap(small);
+            inline_one.push_back(8);
+            std::cout << inline_one.size() << small.size() << small[1];
+        },
+            "10 100000 30 1 65 11 100127");
+
+    jules::tests::test("over-aligned blocks near a chunk end",
+        [&]
+        {
+            // cursor just past the last alignment boundary before the chunk
+            // end, so aligning it steps over the end
+            jules::allocator::arena small(65536);
+            auto start = reinterpret_cast<uintptr_t>(small.allocate(0, 1));
+            auto end = start + small.reserved() - 2 * sizeof(void*);     // after the chunk header
+            size_t alignment = 32;
+            while (end % alignment == 0)
+                alignment *= 2;
+
+            auto cursor = std::max(start, end / alignment * alignment + 1);
+            static_cast<void>(small.allocate(cursor - start, 1));
+            auto reserved = small.reserved();
+            auto block = small.allocate(32, alignment);
+            std::memset(block, 1, 32);
+            std::cout << reinterpret_cast<uintptr_t>(block) % alignment << (small.reserved() > reserved) << " ";
+
+            // blocks of every size and alignment keep to themselves
+            std::vector<std::pair<uint8_t*, size_t>> blocks;
+            bool aligned = true;
+            uint64_t seed = 99;
+            for (size_t i = 0; i != 2000; i++)
+            {
+                seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+                auto bytes = (seed >> 33) % 200 + 1;
+                auto alignment = size_t(1) << ((seed >> 20) % 9);
+                auto ptr = static_cast<uint8_t*>(small.allocate(bytes, alignment));
+                std::memset(ptr, static_cast<int>(i), bytes);
+                blocks.push_back({ ptr, bytes });
+                aligned &= reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+            }
+
+            bool intact = true;
+            for (size_t i = 0; i != blocks.size(); i++)
+                for (size_t j = 0; j != blocks[i].second; j++)
+                    intact &= blocks[i].first[j] == static_cast<uint8_t>(i);
+
+            std::cout << aligned << intact;
+        },
+            "01 11");
+
+    jules::tests::test("scopes nest, reset keeps one chunk",
+        [&]
+        {
+            jules::allocator::arena inner;
+            {
+                jules::allocator::arena::scope outer_use(arena);
+                auto before = arena.used();
+                {
+                    jules::allocator::arena::scope inner_use(inner);
+                    int_vector v(100);
+                    std::cout << (arena.used() == before) << inner.used() << " ";
+                }
+
+                int_vector v(1);
+                std::cout << arena.used() - before << " ";
+            }
+
+            arena.reset();
+            auto reserved = arena.reserved();
+            std::cout << arena.used() << (jules::allocator::arena::current() == nullptr) << " ";
+
+            auto a = arena.allocate(3, 1);
+            auto b = arena.allocate(8, 64);
+            std::cout << (reinterpret_cast<uintptr_t>(b) % 64) << (static_cast<char*>(b) > static_cast<char*>(a))
+                      << (arena.reserved() == reserved);
+
+            arena.release();
+            std::cout << " " << arena.reserved();
+        },
+            "1400 4 01 011 0");
+
+    jules::tests::complete();
+}
+
+void pool()
+{
+    jules::tests::start("pool");
+
+    jules::tests::test("slots, free lists and slabs",
+        [&]
+        {
+            jules::allocator::pool pool(20, 8, 4096);
+            auto stats = pool.occupancy();
+            std::cout << pool.slot_size() << " " << stats.slots_per_slab << " " << stats.slabs << " ";
+
+            // three slabs, every slot once
+            jules::vector<void*> slots;
+            for (size_t i = 0; i != 3 * stats.slots_per_slab; i++)
+                slots.push_back(pool.allocate());
+
+            std::sort(slots.begin(), slots.end());
+            bool distinct = std::adjacent_find(slots.begin(), slots.end()) == slots.end();
+            stats = pool.occupancy();
+            std::cout << distinct << " " << stats.slabs << " " << stats.occupancy() << " ";
+
+            // a returned slot is the next one handed out
+            auto slot = slots[100];
+            pool.deallocate(slot);
+            std::cout << (pool.allocate() == slot) << " ";
+
+            // emptied slabs: one stays as a spare, the rest go back to malloc
+            for (auto ptr : slots)
+                pool.deallocate(ptr);
+
+            stats = pool.occupancy();
+            std::cout << stats.used << " " << stats.slabs << " " << (pool.allocate() != nullptr);
+        },
+            "24 169 0 1 3 1 1 0 1 1");
+
+    jules::tests::test("on_heap vectors of up to 16 ints",
+        [&]
+        {
+            using allocator = jules::allocator::Pool<int, true, 16>;
+            using small = jules::vector<int, allocator>;
+            {
+                jules::vector<small> vectors(1000);
+                for (size_t i = 0; i != vectors.size(); i++)
+                    for (size_t j = 0; j != i % 17; j++)
+                        vectors[i].push_back(static_cast<int>(j));
+
+                // i % 17 == 16 fits a slot exactly, nothing got past 16
+                auto stats = allocator::occupancy();
+                std::cout << vectors[16].capacity() << " " << stats.used << " " << stats.slot_size << " ";
+
+                vectors[16].push_back(16);
+                std::cout << vectors[16].capacity() << " " << allocator::occupancy().used << " ";
+            }
+
+            std::cout << allocator::occupancy().used << " " << allocator::occupancy().slabs;
+        },
+            "16 941 64 32 940 0 1");
+
+    jules::tests::test("bool containers rebind",
+        [&]
+        {
+            using allocator = jules::allocator::Pool<bool, true, 2>;
+            jules::vector<bool, allocator> bits(100, true);
+            bits[99] = false;
+            std::cout << bits.count() << " " << jules::allocator::Pool<uint64_t, true, 2>::occupancy().used;
+        },
+            "99 1");
+
+    jules::tests::test("threads share the pool",
+        [&]
+        {
+            // up to 16 ints, so every vector lives in a slot
+            using allocator = jules::allocator::Pool<int, true, 16>;
+            auto churn = [](int seed, bool* ok)
+            {
+                for (int round = 0; round != 200; round++)
+                {
+                    jules::vector<jules::vector<int, allocator>> vectors(100);
+                    for (size_t i = 0; i != vectors.size(); i++)
+                        for (size_t j = 0; j != i % 17; j++)
+                            vectors[i].push_back(seed + static_cast<int>(j));
+
+                    for (size_t i = 0; i != vectors.size(); i++)
+                        for (size_t j = 0; j != vectors[i].size(); j++)
+                            *ok &= vectors[i][j] == seed + static_cast<int>(j);
+                }
+            };
+
+            bool first = true, second = true;
+            std::thread other(churn, 1000, &second);
+            churn(0, &first);
+            other.join();
+            std::cout << first << second << " " << allocator::occupancy().used;
+        },
+            "11 0");
+
+    jules::tests::complete();
+}
+
+template<typename Vector>
+static bool is_inline_(Vector const& v)
+{
+    auto data = reinterpret_cast<char const*>(v.data());
+    auto self = reinterpret_cast<char const*>(&v);
+    return self <= data && data < self + sizeof(v);
+}
+
+void thread_cache()
+{
+    using cache = jules::allocator::thread_cache;
+    jules::tests::start("thread_cache");
+
+    jules::tests::test("size classes",
+        [&]
+        {
+            std::cout << cache::class_size(cache::class_of(1)) << " " << cache::class_size(cache::class_of(129)) << " "
+                      << cache::class_size(cache::class_of(257)) << " " << cache::class_size(cache::class_of(1000)) << " "
+                      << cache::class_of(cache::max_small) + 1 << " ";
+
+            // smallest class that fits, every size
+            bool tight = true;
+            for (size_t bytes = 1; bytes <= cache::max_small; bytes++)
+            {
+                auto index = cache::class_of(bytes);
+                tight &= cache::class_size(index) >= bytes && (index == 0 || cache::class_size(index - 1) < bytes);
+            }
+
+            std::cout << tight;
+        },
+            "16 160 320 1024 40 1");
+
+    jules::tests::test("vectors take whole classes",
+        [&]
+        {
+            using allocator = jules::allocator::ThreadCache<int, true>;
+            auto index = cache::class_of(1000 * sizeof(int));
+            {
+                jules::vector<int, allocator> v;
+                for (int i = 0; i != 1000; i++)
+                    v.push_back(i);
+
+                // 4000 bytes -> the 4096 class, 1024 ints
+                std::cout << v.capacity() << " " << v[999] << " " << cache::occupancy(index).used << " ";
+                v.push_back(1000);
+                v.push_back(1001);
+            }
+
+            // freed blocks stay in this thread`s cache until flushed
+            std::cout << cache::cached(index) << " ";
+            cache::flush();
+            std::cout << cache::cached(index) << " " << cache::occupancy(index).used;
+        },
+            "1024 999 8 8 0 0");
+
+    jules::tests::test("threads free each other`s blocks",
+        [&]
+        {
+            using allocator = jules::allocator::ThreadCache<int, true>;
+            using vector = jules::vector<int, allocator>;
+            size_t const threads = 4;
+
+            // every thread fills vectors, the next one frees them
+            jules::vector<jules::vector<vector>> made(threads);
+            jules::vector<size_t> sums(threads);
+            auto fill = [&](size_t t)
+            {
+                for (size_t i = 0; i != 500; i++)
+                {
+                    made[t].emplace_back();
+                    for (size_t j = 0; j != 1 + (i * 37 + t) % 700; j++)
+                        made[t].back().push_back(static_cast<int>(j));
+                }
+            };
+
+            auto free = [&](size_t t)
+            {
+                for (auto& v : made[(t + 1) % threads])
+                    sums[t] += v.size();
+
+                made[(t + 1) % threads].clear();
+            };
+
+            jules::vector<std::thread> workers;
+            for (size_t t = 0; t != threads; t++)
+                workers.emplace_back(fill, t);
+            for (auto& worker : workers)
+                worker.join();
+
+            workers.clear();
+            for (size_t t = 0; t != threads; t++)
+                workers.emplace_back(free, t);
+            for (auto& worker : workers)
+                worker.join();
+
+            // exited threads gave everything back
+            size_t used = 0;
+            for (size_t i = 0; i != cache::classes; i++)
+                used += cache::occupancy(i).used;
+
+            std::cout << (sums[0] + sums[1] + sums[2] + sums[3]) << " " << used;
+        },
+            "692900 0");
+
+    jules::tests::complete();
+}
+
+void aligned()
+{
+    jules::tests::start("aligned");
+
+    auto offset = [](void const* ptr, size_t alignment)
+    {
+        return reinterpret_cast<uintptr_t>(ptr) % alignment;
+    };
+
+    jules::tests::test("Aligned allocator",
+        [&]
+        {
+            using vector = jules::vector<float, jules::allocator::Aligned<float, true, 64>>;
+            vector v;
+            bool aligned = true;
+            for (int i = 0; i != 1000; i++)
+            {
+                v.push_back(static_cast<float>(i));
+                aligned &= offset(v.data(), 64) == 0;
+            }
+
+            // blocks are whole cache lines
+            float sum = 0;
+            auto data = v.aligned_data();
+            for (size_t i = 0; i != v.size(); i++)
+                sum += data[i];
+
+            std::cout << vector::alignment << " " << aligned << " " << v.capacity() % 16 << " " << sum;
+        },
+            "64 1 0 499500");
+
+    jules::tests::test("over-aligned stack buffers",
+        [&]
+        {
+            using line = jules::static_vector<char, 3, jules::overflow::throws, 64>;
+            line lines[3];
+            lines[0].push_back('a');
+            std::cout << line::alignment << " " << offset(lines[1].data(), 64) << " "
+                      << (lines[1].data() - lines[0].data()) << " ";
+
+            // inline buffer and heap blocks alike
+            using small = jules::small_vector<float, 4, jules::allocator::Aligned<float, true, 32>>;
+            small v = { 1, 2, 3 };
+            std::cout << small::alignment << " " << offset(v.data(), 32) << " ";
+            for (int i = 0; i != 100; i++)
+                v.push_back(0);
+            std::cout << offset(v.data(), 32) << " ";
+
+            std::cout << jules::vector<float, jules::allocator::Default<float, true>, jules::storage::on_mmap>::alignment << " "
+                      << jules::vector<double>::alignment << " " << jules::static_vector<double, 2>::alignment;
+        },
+            "64 0 128 32 0 0 4096 8 8");
+
+    jules::tests::test("bool containers rebind",
+        [&]
+        {
+            jules::vector<bool, jules::allocator::Aligned<bool, true, 64>> bits(1000, true);
+            std::cout << bits.count() << " " << offset(bits.word_data(), 64);
+        },
+            "1000 0");
+
+    jules::tests::complete();
+}
+
+void huge_pages()
+{
+    using jules::allocator::huge_pages;
+    jules::tests::start("huge_pages");
+
+    using table = jules::vector<uint64_t, jules::allocator::HugePages<uint64_t, true>>;
+    table v;
+
+    jules::tests::test("small blocks from malloc",
+        [&]
+        {
+            for (uint64_t i = 0; i != 1000; i++)
+                v.push_back(i);
+
+            std::cout << v.size() << " " << (v.capacity() * sizeof(uint64_t) < huge_pages::huge_page);
+        },
+            "1000 1");
+
+    jules::tests::test("huge blocks are 2 MB aligned",
+        [&]
+        {
+            for (uint64_t i = 1000; i != 1 << 20; i++)
+                v.push_back(i);
+
+            uint64_t sum = 0;
+            for (auto x : v)
+                sum += x;
+
+            std::cout << sum << " " << reinterpret_cast<uintptr_t>(v.data()) % huge_pages::huge_page << " "
+                      << v.capacity() * sizeof(uint64_t) % huge_pages::huge_page;
+        },
+            "549755289600 0 0");
+
+    jules::tests::test("shrinks back to malloc",
+        [&]
+        {
+            v.resize(10);
+            v.shrink_to_fit();
+            std::cout << v[9] << " " << (v.capacity() * sizeof(uint64_t) < huge_pages::huge_page);
+        },
+            "9 1");
+
+    jules::tests::test("HugeTLB falls back to THP",
+        [&]
+        {
+            // without reserved huge pages MAP_HUGETLB fails, both paths are aligned
+            jules::vector<uint64_t, jules::allocator::HugePages<uint64_t, true, true>> w(1 << 19, 7);
+            std::cout << w[12345] << " " << reinterpret_cast<uintptr_t>(w.data()) % huge_pages::huge_page;
+        },
+            "7 0");
+
+    jules::tests::complete();
+}
+
+void small_vector()
+{
+    jules::tests::start("small_vector");
+
+    jules::small_vector<int, 8> v;
+
+    jules::tests::test("inline up to N",
+        [&]
+        {
+            for (int i = 0; i != 8; i++)
+                v.push_back(i);
+
+            std::cout << is_inline_(v) << " " << v.capacity() << " " << v[7];
+        },
+            "1 8 7");
+
+    jules::tests::test("spills to heap",
+        [&]
+        {
+            v.push_back(8);
+            std::cout << is_inline_(v) << " " << (v.capacity() > 8);
+            for (auto x : v)
+                std::cout << " " << x;
+        },
+            "0 1 0 1 2 3 4 5 6 7 8");
+
+    jules::tests::test("comes back inline",
+        [&]
+        {
+            v.resize(3);
+            v.shrink_to_fit();
+            std::cout << is_inline_(v) << " " << v.capacity() << " " << v[0] << v[1] << v[2];
+        },
+            "1 8 012");
+
+    jules::tests::test("move inline strings",
+        [&]
+        {
+            jules::small_vector<std::string, 4> strings = { "a", "b", "c" };
+            auto moved = std::move(strings);
+            std::cout << is_inline_(moved) << " " << strings.size() << " ";
+            for (auto const& s : moved)
+                std::cout << s;
+        },
+            "1 0 abc");
+
+    jules::tests::test("move heap strings steals",
+        [&]
+        {
+            jules::small_vector<std::string, 2> strings = { "a", "b", "c" };
+            auto data = strings.data();
+            jules::small_vector<std::string, 2> moved;
+            moved = std::move(strings);
+            std::cout << (moved.data() == data) << " " << is_inline_(strings) << " ";
+            for (auto const& s : moved)
+                std::cout << s;
+        },
+            "1 1 abc");
+
+    jules::tests::test("copy",
+        [&]
+        {
+            jules::small_vector<std::string, 2> strings = { "a", "b", "c" };
+            auto copy = strings;
+            copy.pop_back();
+            copy.shrink_to_fit();
+            std::cout << is_inline_(copy) << " " << copy[0] << copy[1] << " " << strings.size();
+        },
+            "1 ab 3");
+
+    jules::tests::complete();
+}
+
+void static_vector()
+{
+    jules::tests::start("static_vector");
+
+    jules::static_vector<int, 4> v;
+
+    jules::tests::test("inline, fixed capacity",
+        [&]
+        {
+            for (int i = 0; i != 4; i++)
+                v.push_back(i);
+
+            v.pop_back();
+            v.shrink_to_fit();
+            std::cout << is_inline_(v) << " " << v.capacity() << " " << v.size();
+        },
+            "1 4 3");
+
+    jules::tests::test_exception("throws on overflow",
+        [&]
+        {
+            v.push_back(3);
+            v.push_back(4);
+        });
+
+    jules::tests::test("nothing changed by the overflow",
+        [&]
+        {
+            for (auto x : v)
+                std::cout << x;
+        },
+            "0123");
+
+    jules::tests::test("drops what doesn`t fit",
+        [&]
+        {
+            jules::static_vector<int, 3, jules::overflow::drops> d = { 1, 2, 3, 4, 5 };
+            d.push_back(6);
+            std::cout << (d.insert(d.begin(), 0) == d.end()) << " ";
+            d.resize(10);
+            for (auto x : d)
+                std::cout << x;
+        },
+            "1 123");
+
+    jules::tests::test("bools drop what doesn`t fit",
+        [&]
+        {
+            // two words, 128 bits
+            using bits = jules::static_vector<bool, 2, jules::overflow::drops>;
+            bits d;
+            for (int i = 0; i != 200; i++)
+                d.push_back(i % 2 == 0);
+            std::cout << d.size() << " " << d.count() << " ";
+
+            std::cout << (d.insert(d.begin(), true) == d.end()) << (d.insert(d.begin(), 5, true) == d.end())
+                      << (d.insert(d.end(), { true, false }) == d.end()) << " ";
+
+            d.resize(100);
+            d.resize(1000, true);
+            d.reserve(1000);
+            std::cout << d.size() << " " << d.count() << " " << d.capacity() << " ";
+
+            bits e(300, true), f = { true, true, true };
+            f |= e;
+            std::cout << e.size() << e.count() << " " << f.size() << f.count() << " "
+                      << (d.insert(d.begin(), f.begin(), f.end()) == d.end());
+        },
+            "128 64 111 128 78 128 128128 128128 1");
+
+    jules::tests::test("copy, move and swap strings",
+        [&]
+        {
+            jules::static_vector<std::string, 4> a = { "a", "b", "c" };
+            jules::static_vector<std::string, 4> b = { "x" };
+            auto c = a;
+            auto d = std::move(c);
+            d.swap(b);
+            std::cout << d.size() << b.size() << " " << d[0] << " ";
+            for (auto const& s : b)
+                std::cout << s;
+        },
+            "13 x abc");
+
+    jules::tests::complete();
+}
+
 void strange_tests()
 {
     jules::tests::start("strange_tests");
@@ -642,4 +2832,26 @@ int main()
     default_config_bool();
     iterator_tests_bool();
     emplace_insert_remove_bool();
+    bool_words();
+    bool_bit_queries();
+    bool_bitwise();
+    bool_word_shifts();
+    bool_set_bits();
+    bit_kernels();
+    rank_select();
+    roaring();
+    packed_vector();
+    bit_span();
+    arena();
+    pool();
+    thread_cache();
+    aligned();
+    huge_pages();
+    growth_policies();
+    bulk_insert();
+    for_overwrite();
+    allocator_protocol();
+    mmap_storage();
+    small_vector();
+    static_vector();
 }
\ No newline at end of file